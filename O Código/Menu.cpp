@@ -0,0 +1,76 @@
+#include "Menu.h"
+
+Menu::Menu(TextLCD_Base& lcd) : _lcd(lcd), _def(nullptr), _visiveis(0), _cursor(0), _inicio(0) {}
+
+void Menu::open(const MenuDef& def, int cursor) {
+    _def = &def;
+    _visiveis = _lcd.rows() - 1;  //linha 0 é do título
+    if (_visiveis > def.num) _visiveis = def.num;
+    if (cursor < 0 || cursor >= def.num) cursor = 0;
+    _cursor = cursor;
+    _inicio = cursor < _visiveis ? 0 : cursor - (_visiveis - 1);
+    redraw();
+}
+
+void Menu::redraw() {
+    if (!_def) return;
+    _lcd.cls();
+    _lcd.locate(_def->colTitulo, 0); _lcd.printf("%s", _def->titulo);
+    for (int i = 0; i < _visiveis; ++i) drawItem(i, _inicio + i, -1);
+    _lcd.locate(0, 1 + _cursor - _inicio); _lcd.putc('>');
+    _lcd.flush();
+}
+
+void Menu::up() {
+    if (_def) moveTo((_cursor - 1 + _def->num) % _def->num);
+}
+
+void Menu::down() {
+    if (_def) moveTo((_cursor + 1) % _def->num);
+}
+
+void Menu::select() {
+    if (_def && _def->itens[_cursor].acao) _def->itens[_cursor].acao();
+}
+
+bool Menu::back() {
+    if (!_def || !_def->pai) return false;
+    open(*_def->pai);
+    return true;
+}
+
+//Desloca a janela só o necessário para mostrar o cursor e reescreve apenas o
+//que mudou: as linhas da janela (se rolou) e as duas células do '>'
+void Menu::moveTo(int cursor) {
+    int inicio = _inicio;
+    if (cursor < inicio)                   inicio = cursor;
+    else if (cursor >= inicio + _visiveis) inicio = cursor - (_visiveis - 1);
+
+    if (inicio != _inicio) {
+        for (int i = 0; i < _visiveis; ++i) drawItem(i, inicio + i, _inicio + i);
+    }
+
+    int linhaAntiga = _cursor - _inicio;
+    int linha       = cursor - inicio;
+    if (linha != linhaAntiga) {
+        _lcd.locate(0, 1 + linhaAntiga); _lcd.putc(' ');
+        _lcd.locate(0, 1 + linha);       _lcd.putc('>');
+    }
+    _cursor = cursor;
+    _inicio = inicio;
+    _lcd.flush();
+}
+
+//Escreve o item idx na linha; idxAntigo é o item que estava lá (-1 → linha
+//limpa). Texto igual não é reescrito; sobra do texto antigo vira espaço.
+void Menu::drawItem(int linha, int idx, int idxAntigo) {
+    const char* texto = _def->itens[idx].texto;
+    int antigo = 0;
+    if (idxAntigo >= 0) {
+        const char* anterior = _def->itens[idxAntigo].texto;
+        if (strcmp(texto, anterior) == 0) return;
+        antigo = strlen(anterior);
+    }
+    _lcd.locate(1, 1 + linha); _lcd.printf("%s", texto);
+    for (int n = strlen(texto); n < antigo; ++n) _lcd.putc(' ');
+}
@@ -0,0 +1,60 @@
+// Menu.h
+#ifndef MENU_H
+#define MENU_H
+
+#include "mbed.h"
+#include "TextLCD.h"
+
+// Número de itens de uma tabela de menu
+#define MENU_NUM(itens) uint8_t(sizeof(itens) / sizeof((itens)[0]))
+
+// Item de menu: texto na tela e ação do Enter
+struct MenuItem {
+    const char* texto;
+    void      (*acao)(void);
+};
+
+// Menu definido em tempo de compilação (tabelas const ficam na flash)
+struct MenuDef {
+    const char*     titulo;
+    uint8_t         colTitulo;  // coluna do título na linha 0
+    const MenuItem* itens;
+    uint8_t         num;
+    const MenuDef*  pai;        // destino do Back (nullptr → nenhum)
+};
+
+// Menu rolável: título na linha 0 e os itens nas linhas seguintes, com '>'
+// na coluna 0. Guarda a janela e o cursor desenhados, então um passo dentro da
+// janela reescreve só as duas células do '>' e uma rolagem só as linhas cujo
+// texto muda, sem cls.
+class Menu {
+public:
+    explicit Menu(TextLCD_Base& lcd);
+
+    // Troca de menu com o cursor no item indicado e desenha a tela inteira
+    void open(const MenuDef& def, int cursor = 0);
+    // Redesenha a tela inteira (volta de outra tela)
+    void redraw();
+    // Cursor para cima/baixo, com volta ao fim/início
+    void up();
+    void down();
+    // Executa a ação do item selecionado
+    void select();
+    // Volta ao menu pai; false se não houver
+    bool back();
+
+    const MenuDef* current() const { return _def; }
+    int            cursor() const  { return _cursor; }
+
+private:
+    void moveTo(int cursor);
+    void drawItem(int linha, int idx, int idxAntigo);
+
+    TextLCD_Base&  _lcd;
+    const MenuDef* _def;
+    int            _visiveis;  // linhas de itens na tela
+    int            _cursor;
+    int            _inicio;    // primeiro item da janela desenhada
+};
+
+#endif // MENU_H
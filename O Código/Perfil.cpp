@@ -0,0 +1,112 @@
+#include "Perfil.h"
+
+// Tabela de escopos: preenchida pelos construtores estáticos, antes do main()
+static PerfilEscopo* escopos[PERFIL_MAX];
+static int           numEscopos;
+static Kernel::Clock::time_point inicioJanela;
+
+PerfilEscopo::PerfilEscopo(const char* n) : nome(n), chamadas(0), total(0), maximo(0), faixas{} {
+    // o CYCCNT só conta com o rastreio ligado (sem depurador ele começa desligado)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    if (numEscopos < PERFIL_MAX) escopos[numEscopos++] = this;
+}
+
+// Chamado de ISR e de threads: a seção crítica custa menos que o escopo medido
+void PerfilEscopo::registrar(uint32_t ciclos) {
+    const uint32_t umUs = SystemCoreClock / 1000000;
+    int k = 0;
+    for (uint32_t limite = umUs; k < PERFIL_FAIXAS - 1 && ciclos >= limite; limite <<= 1) ++k;
+    CriticalSectionLock lock;
+    ++chamadas;
+    total += ciclos;
+    if (ciclos > maximo) maximo = ciclos;
+    ++faixas[k];
+}
+
+void Perfil_Reset(void) {
+    CriticalSectionLock lock;
+    for (int i = 0; i < numEscopos; ++i) {
+        PerfilEscopo* e = escopos[i];
+        e->chamadas = 0;
+        e->total    = 0;
+        e->maximo   = 0;
+        for (int k = 0; k < PERFIL_FAIXAS; ++k) e->faixas[k] = 0;
+    }
+    inicioJanela = Kernel::Clock::now();
+}
+
+int Perfil_Num(void) { return numEscopos; }
+
+const PerfilEscopo* Perfil_Get(int i) {
+    return (i >= 0 && i < numEscopos) ? escopos[i] : nullptr;
+}
+
+uint32_t Perfil_JanelaMs(void) {
+    return uint32_t((Kernel::Clock::now() - inicioJanela).count());
+}
+
+uint32_t Perfil_Us(uint64_t ciclos) {
+    return uint32_t(ciclos / (SystemCoreClock / 1000000));
+}
+
+uint32_t Perfil_Ocupacao(const PerfilEscopo* e) {
+    uint64_t janela = uint64_t(Perfil_JanelaMs()) * (SystemCoreClock / 1000);
+    return janela ? uint32_t(e->total * 1000 / janela) : 0;
+}
+
+// Coluna de largura fixa com espaços escritos à mão: o minimal-printf do alvo
+// não trata largura, '*' nem '-' nos formatos
+static void coluna(const char* texto, int largura, bool esquerda) {
+    int n = int(strlen(texto));
+    if (esquerda) printf("%s", texto);
+    for (; n < largura; ++n) putchar(' ');
+    if (!esquerda) printf("%s", texto);
+}
+
+// " " e o número alinhado à direita em largura colunas
+static void colunaNum(uint32_t v, int largura) {
+    char t[12];
+    snprintf(t, sizeof(t), "%lu", (unsigned long)v);
+    putchar(' ');
+    coluna(t, largura, false);
+}
+
+// " " e décimos como "int.dec", alinhado à direita em largura colunas
+static void colunaDecimos(uint32_t v, int largura) {
+    char t[14];
+    snprintf(t, sizeof(t), "%lu.%lu", (unsigned long)(v / 10), (unsigned long)(v % 10));
+    putchar(' ');
+    coluna(t, largura, false);
+}
+
+void Perfil_Dump(void) {
+    printf("#perfil %lu ms %lu Hz\n", (unsigned long)Perfil_JanelaMs(), (unsigned long)SystemCoreClock);
+    coluna("escopo", PERFIL_NOME, true);
+    printf(" chamadas   total_us  cpu%%  medio_us  max_us |");
+    for (int k = 0; k < PERFIL_FAIXAS; ++k) {
+        char faixa[8];
+        snprintf(faixa, sizeof(faixa), k < PERFIL_FAIXAS - 1 ? "<%d" : ">=%d", 1 << (k < PERFIL_FAIXAS - 1 ? k : k - 1));
+        putchar(' ');
+        coluna(faixa, 6, false);
+    }
+    printf("\n");
+    for (int i = 0; i < numEscopos; ++i) {
+        // retrato consistente: as ISR continuam contando durante o printf
+        core_util_critical_section_enter();
+        const PerfilEscopo e(*escopos[i]);
+        core_util_critical_section_exit();
+        uint32_t totalUs = Perfil_Us(e.total);
+        uint32_t cpu     = Perfil_Ocupacao(&e);
+        uint32_t medio   = e.chamadas ? Perfil_Us(e.total * 10) / e.chamadas : 0;  // décimos de us
+        coluna(e.nome, PERFIL_NOME, true);
+        colunaNum(e.chamadas, 8);
+        colunaNum(totalUs, 10);
+        colunaDecimos(cpu, 5);
+        colunaDecimos(medio, 9);
+        colunaNum(Perfil_Us(e.maximo), 7);
+        printf(" |");
+        for (int k = 0; k < PERFIL_FAIXAS; ++k) colunaNum(e.faixas[k], 6);
+        printf("\n");
+    }
+}
@@ -0,0 +1,70 @@
+// Perfil.h
+// Perfil de tempo por escopo com o contador de ciclos do DWT: cada escopo é um
+// objeto estático (tabela fixa, sem alocação) com chamadas, total, máximo e um
+// histograma em potências de 2 de microssegundos. A medida é o tempo de parede
+// entre a entrada e a saída do bloco: nas ISR é o tempo de CPU, nas threads
+// inclui preempção e esperas.
+//
+//   PERFIL_DEFINIR(perfPassos, "passos");   // no escopo do arquivo
+//   void StepEngine::handler() { PERFIL_MEDIR(perfPassos); ... }
+#ifndef PERFIL_H
+#define PERFIL_H
+
+#include "mbed.h"
+
+// 0 → as macros não geram código
+#ifndef PERFIL
+#define PERFIL 1
+#endif
+
+#define PERFIL_MAX    16   // escopos registrados
+#define PERFIL_FAIXAS 10   // <1, <2, <4 ... <256 us e >= 256 us
+#define PERFIL_NOME   9    // colunas do nome no LCD e no console
+
+struct PerfilEscopo {
+    explicit PerfilEscopo(const char* nome);
+    void registrar(uint32_t ciclos);
+
+    const char* nome;
+    uint32_t    chamadas;
+    uint64_t    total;     // ciclos
+    uint32_t    maximo;    // ciclos
+    uint32_t    faixas[PERFIL_FAIXAS];
+};
+
+// Mede do construtor ao fim do bloco
+class PerfilMedida {
+public:
+    explicit PerfilMedida(PerfilEscopo& e) : _e(e), _inicio(DWT->CYCCNT) {}
+    ~PerfilMedida() { _e.registrar(DWT->CYCCNT - _inicio); }
+private:
+    PerfilEscopo& _e;
+    uint32_t      _inicio;
+};
+
+#if PERFIL
+// No escopo do arquivo: um static local teria guarda de inicialização dentro da ISR
+#define PERFIL_DEFINIR(var, nome) static PerfilEscopo var(nome)
+#define PERFIL_MEDIR(var)         PerfilMedida perfilMedida_##var(var)
+#else
+#define PERFIL_DEFINIR(var, nome)
+#define PERFIL_MEDIR(var)
+#endif
+
+// Zera os contadores e recomeça a janela de medida
+void Perfil_Reset(void);
+// Escopos na ordem de registro
+int                 Perfil_Num(void);
+const PerfilEscopo* Perfil_Get(int i);
+// Duração da janela desde o último Perfil_Reset (ms)
+uint32_t Perfil_JanelaMs(void);
+// Ocupação do escopo na janela, em décimos de %
+uint32_t Perfil_Ocupacao(const PerfilEscopo* e);
+// Microssegundos a partir de ciclos
+uint32_t Perfil_Us(uint64_t ciclos);
+// Tabela no console:
+//   #perfil janela_ms hz
+//   escopo chamadas total_us cpu% medio_us max_us | contagem por faixa
+void Perfil_Dump(void);
+
+#endif // PERFIL_H
@@ -1,6 +1,10 @@
 #include "mbed.h"
 #include "pinos.h"
 #include "Pipetadora.h"
+#include "StepEngine.h"
+#include "Planner.h"
+#include "Perfil.h"
+#include "Registro.h"
 
 // emergência interna
 static DigitalIn emergPin(EMER_2, PullUp);
@@ -23,23 +27,25 @@ static constexpr int TIME_PER_ML_MS = 50; // ajuste conforme calibração
 static DigitalIn* switchSelect;    // lê o switch Y↔Z
 static DigitalIn* endMinZ;         // fim-de-curso Z inferior
 static DigitalIn* endMaxZ;         // fim-de-curso Z superior
-static volatile int32_t positionZ; // contador de passos Z
 static constexpr float PASSO_FUSO_Z = 1.0f;
-static int zSeqIndex = 0;          // índice de sequência de bobinas Z
 
-// velocidades Z (milissegundos)
+// velocidades Z (milissegundos por passo cheio)
 static constexpr milliseconds VEL_STEP_MS_Z_HIGH   = 3ms;
 static constexpr milliseconds VEL_STEP_MS_Z_MEDIUM = 4ms;
 static constexpr milliseconds VEL_STEP_MS_Z_LOW    = 5ms;
 static milliseconds velStepMsZCurrent = VEL_STEP_MS_Z_HIGH;
 
-// ------------------------------------------------------------------
-// Algoritmo de Bresenham (movimento linear XY)
-// ------------------------------------------------------------------
-static volatile int lin_x0, lin_y0, lin_tx, lin_ty, lin_dx, lin_dy, lin_sx, lin_sy, lin_err;
+// rampa Z: parte do período de partida e acelera até o período do automático,
+// mais rápido que o manual porque não há mais partida direta nessa velocidade
+static constexpr microseconds PERIODO_INICIAL_Z = 5000us;   // por passo cheio
+static constexpr microseconds PERIODO_Z_AUTO    = 2000us;   // por passo cheio
+static constexpr float        ACELERACAO_Z      = 2000.0f;  // passos cheios/s²
+static constexpr int          TAM_RAMPA_Z       = 256;
+static uint16_t rampaZ[TAM_RAMPA_Z];
 
-// — Identificadores de eixos X e Y
+// — Identificadores de eixos X e Y (Z usa o índice seguinte)
 enum MotorId { MotorX = 0, MotorY = 1, MotorCount };
+static constexpr int MotorZ = MotorCount;
 
 // — Estado de toggle Y↔Z
 static bool swMode = false;
@@ -52,11 +58,28 @@ static constexpr microseconds PERIODO_MINIMO_MED   [MotorCount] = { 300us, 350us
 static constexpr microseconds PERIODO_MINIMO_SLOW  [MotorCount] = { 700us, 700us };
 static microseconds periodoMinAtual[MotorCount];
 
-static microseconds periodCur    [MotorCount];
-static constexpr microseconds REDUCAO_PERIODO    [MotorCount] = { 25us, 25us };
-static constexpr int          PASSOS_PARA_ACELERAR        = 25;
+static constexpr float        ACELERACAO[MotorCount]      = { 40000.0f, 40000.0f }; // bordas/s²
+static constexpr int          TAM_RAMPA                   = 512;
 static constexpr float        PASSO_FUSO[MotorCount]      = { 0.5f, 0.5f };
-static constexpr microseconds INTERP_PERIOD             = PERIODO_INICIAL[MotorX] / 3;
+
+// — Tabelas de aceleração constante (período de cada borda a partir do repouso);
+//   rampaCheia segue os limites de ponteira cheia e só é usada pela fila
+static uint16_t rampa[MotorCount][TAM_RAMPA];
+static uint16_t rampaCheia[MotorCount][TAM_RAMPA];
+
+// — Perfil S: limites por eixo (X, Y, Z) e por fase da ponteira { vazia, cheia }
+static Pipetadora_Limites limitesS[STEP_EIXOS][2] = {
+    { { 5700.0f, 40000.0f, 800000.0f }, { 4000.0f, 15000.0f, 150000.0f } },
+    { { 5000.0f, 40000.0f, 800000.0f }, { 3500.0f, 15000.0f, 150000.0f } },
+    { {  666.0f,  4000.0f,  80000.0f }, {  500.0f,  2000.0f,  40000.0f } },
+};
+static Pipetadora_Perfil perfilAtual = PERFIL_TRAPEZIO;
+static Pipetadora_Fase   faseAtual   = PONTEIRA_VAZIA;
+
+// — Curvas S geradas antes de cada movimento (XY e Z podem rodar juntos)
+static constexpr int TAM_CURVA = 768;
+static uint16_t curvaXY[TAM_CURVA];
+static uint16_t curvaZ [TAM_CURVA];
 
 // — Pinos drivers (X, Y)
 static constexpr PinName STEP_PIN   [MotorCount] = { MOTOR_X, MOTOR_Y };
@@ -75,32 +98,45 @@ static DigitalIn*  endMin    [MotorCount];
 static DigitalIn*  endMax    [MotorCount];
 static DigitalIn*  btnUp     [MotorCount];
 static DigitalIn*  btnDwn    [MotorCount];
-static Ticker*     tickers   [MotorCount];
-static volatile bool       tickerOn    [MotorCount];
-static volatile int32_t    position    [MotorCount];
-static int                 passoCount  [MotorCount];
-static int                 dirState    [MotorCount]; // 0 → frente, 1 → trás
-
-// — Wrappers para Ticker X/Y
-static void stepISR(int id);
-static void stepISR0() { stepISR(0); }
-static void stepISR1() { stepISR(1); }
-static void (* const stepWrapper[MotorCount])() = { stepISR0, stepISR1 };
-static void stepLinearX_wrapper();
-static void stepLinearY_wrapper();
-
-// — Controle direto do Z
-static constexpr uint8_t SEQ_Z[4] = { 0b0001,0b0010,0b0100,0b1000 };
+
+// — Gerador de passos único para X, Y e Z (um só evento de timer)
+static StepEngine motor;
+
+// — Fila de trechos com lookahead consumida pelo gerador de passos
+static Planner planner;
+
+// — Tempo do planejamento das junções (tela Perfil CPU)
+PERFIL_DEFINIR(perfPlano, "plano");
+
+// — Conclusão de movimentos: um bit por eixo, fim da fila e falha
+static EventFlags movFlags;
+static constexpr uint32_t FLAGS_EIXOS = (1u << STEP_EIXOS) - 1;
+static constexpr uint32_t FLAG_FILA   = 1u << STEP_FILA;
+static constexpr uint32_t FLAG_FALHA  = 1u << (STEP_FILA + 1);
+// fila posta a rodar por RunQueue/StartQueue e ainda não conferida por WaitQueue
+static bool filaIniciada = false;
+// callback pendente de cada movimento assíncrono, guardado no menor eixo do handle
+static Pipetadora_Callback callbackEixo[STEP_EIXOS];
+static Pipetadora_Handle   handleEixo  [STEP_EIXOS];
+
+// — Controle direto do Z: posição em meios passos (2 por passo cheio, como X/Y)
+static constexpr uint8_t SEQ_Z[4]      = { 0b0001,0b0010,0b0100,0b1000 };
+static constexpr uint8_t SEQ_Z_MEIO[8] = { 0b0001,0b0011,0b0010,0b0110,
+                                           0b0100,0b1100,0b1000,0b1001 };
 static BusOut coilsZ(Z_A1, Z_A2, Z_B1, Z_B2);
+static int passoZ = 2;   // unidades de posição por entrada da sequência
 
 // — Protótipos internos
-static void startTicker(int id);
-static void stopTicker (int id);
 static void Mover_Frente(int id);
 static void Mover_Tras  (int id);
 static void Parar_Mov   (int id);
 static void HomingXY    (void);
 static void homingZ     (void);
+static void montarRampaCheia(int id);
+static void montarRampaZ    (void);
+static microseconds periodoZ(microseconds porPasso);
+static void movimentoConcluido(int id, bool falha);
+static void prepararFila(void);
 
 // — API pública —
 void Pipetadora_InitMotors(void) {
@@ -112,23 +148,31 @@ void Pipetadora_InitMotors(void) {
         endMax    [i] = new DigitalIn (ENDMAX_PIN [i], PullDown);
         btnUp     [i] = new DigitalIn (BTN_UP_PIN  [i], PullDown);
         btnDwn    [i] = new DigitalIn (BTN_DWN_PIN [i], PullDown);
-        tickers   [i] = new Ticker();
 
-        position   [i] = 0;
-        tickerOn   [i] = false;
-        periodCur  [i] = PERIODO_INICIAL[i];
         periodoMinAtual[i] = PERIODO_MINIMO_FAST[i];  // manual inicial: rápida
-        passoCount [i] = 0;
-        dirState   [i] = 0;
+        motor.attachDriver(i, stepOut[i], dirOut[i], enableOut[i], endMin[i], endMax[i]);
+        int len = StepEngine::buildRamp(rampa[i], TAM_RAMPA, PERIODO_INICIAL[i],
+                                        PERIODO_MINIMO_FAST[i], ACELERACAO[i]);
+        motor.setRamp(i, rampa[i], len, periodoMinAtual[i]);
+        planner.setAxis(i, PONTEIRA_VAZIA, rampa[i], len,
+                        1e6f / PERIODO_INICIAL[i].count(), ACELERACAO[i]);
+        montarRampaCheia(i);
     }
     coilsZ = 0;
     switchSelect = new DigitalIn(SWITCH_PIN, PullDown);
     endMinZ      = new DigitalIn(FDC_ZDWN,   PullDown);
     endMaxZ      = new DigitalIn(FDC_ZUP,    PullDown);
-    positionZ    = 0;
+    motor.attachCoils(MotorZ, &coilsZ, SEQ_Z, 4, passoZ, endMinZ, endMaxZ);
+    montarRampaZ();
+    motor.setHomeOnLimit(MotorZ, true);
+    motor.setSafeHeight(0);    // até ser configurada: só com o Z no topo
 
     pipette = new DigitalOut(PIPETA);
     pipette->write(0);
+    motor.attachPlanner(&planner, pipette);
+    movFlags.set(FLAGS_EIXOS | FLAG_FILA);   // nada em movimento
+    motor.attachDone(callback(movimentoConcluido));
+    Pipetadora_TraceStart(NULL);
 }
 
 //Chama ambas as funções de referenciamento de eixo
@@ -137,22 +181,6 @@ void Pipetadora_Homing(void) {
     HomingXY();
 }
 
-//Aciona motor de passo no sentido horario
-static void stepZForward() {
-    if (endMaxZ->read()) { coilsZ = 0; return; }
-    coilsZ = SEQ_Z[zSeqIndex];
-    zSeqIndex = (zSeqIndex + 1) % 4;
-    positionZ++;
-}
-
-//Aciona motor de passo no sentido antihorario
-static void stepZBackward() {
-    if (endMinZ->read()) { coilsZ = 0; return; }
-    zSeqIndex = (zSeqIndex + 3) % 4;
-    coilsZ = SEQ_Z[zSeqIndex];
-    positionZ--;
-}
-
 //Definições e funções do jog manual da pipetadora
 void Pipetadora_ManualControl(void) {
     // 1) Toggle Y↔Z
@@ -161,7 +189,7 @@ void Pipetadora_ManualControl(void) {
         swMode = !swMode;
         Parar_Mov(MotorX);
         Parar_Mov(MotorY);
-        coilsZ = 0;
+        Parar_Mov(MotorZ);
     }
     prevSwRaw = raw;
 
@@ -181,28 +209,26 @@ void Pipetadora_ManualControl(void) {
     else if (velo2Pin.read()) velStepMsZCurrent = VEL_STEP_MS_Z_MEDIUM;
     else                       velStepMsZCurrent = VEL_STEP_MS_Z_HIGH;
 
+    for (int i = 0; i < MotorCount; ++i) motor.setMinPeriod(i, periodoMinAtual[i]);
+    motor.setMinPeriod(MotorZ, periodoZ(velStepMsZCurrent));
+
     // 4) Movimento manual do eixo X ou Z
     {
         bool upX = btnUp[MotorX]->read();
         bool dnX = btnDwn[MotorX]->read();
-        if (!swMode) {
-            if      (upX && !dnX) { if (!tickerOn[MotorX] || dirState[MotorX]!=0) Mover_Frente(MotorX); }
-            else if (dnX && !upX) { if (!tickerOn[MotorX] || dirState[MotorX]!=1) Mover_Tras(MotorX); }
-            else                  { if (tickerOn[MotorX]) Parar_Mov(MotorX); }
-        } else {
-            if      (upX && !dnX) stepZForward();
-            else if (dnX && !upX) stepZBackward();
-            else                  coilsZ = 0;
-        }
+        int id = swMode ? MotorZ : MotorX;
+        if      (upX && !dnX) { if (!motor.jogging(id) || motor.direction(id)!=0) Mover_Frente(id); }
+        else if (dnX && !upX) { if (!motor.jogging(id) || motor.direction(id)!=1) Mover_Tras(id); }
+        else                  { if (motor.jogging(id)) Parar_Mov(id); }
     }
 
     // 5) Movimento manual do eixo Y
     {
         bool upY = btnUp[MotorY]->read();
         bool dnY = btnDwn[MotorY]->read();
-        if      (upY && !dnY) { if (!tickerOn[MotorY] || dirState[MotorY]!=0) Mover_Frente(MotorY); }
-        else if (dnY && !upY) { if (!tickerOn[MotorY] || dirState[MotorY]!=1) Mover_Tras(MotorY); }
-        else                  { if (tickerOn[MotorY]) Parar_Mov(MotorY); }
+        if      (upY && !dnY) { if (!motor.jogging(MotorY) || motor.direction(MotorY)!=0) Mover_Frente(MotorY); }
+        else if (dnY && !upY) { if (!motor.jogging(MotorY) || motor.direction(MotorY)!=1) Mover_Tras(MotorY); }
+        else                  { if (motor.jogging(MotorY)) Parar_Mov(MotorY); }
     }
 
     // 6) Delay único para suavizar manual
@@ -214,250 +240,432 @@ extern "C" bool Pipetadora_GetToggleMode(void) {
     return swMode;
 }
 
-//calcula a conversão de passo pra cm (não implementado)
+//Conversão de posição (passos; Z em meios passos) para mm
+static float paraMm(int id, int32_t pos) {
+    if (id < MotorCount) return pos * PASSO_FUSO[id] * 10.0f / 400.0f;
+    return pos * PASSO_FUSO_Z * 10.0f / 800.0f;
+}
+
+//calcula a conversão de passo pra cm
 float Pipetadora_GetPositionCm(int id) {
-    if (id < MotorCount) return float(position[id] * PASSO_FUSO[id] / 400.0f);
-    return float(positionZ * PASSO_FUSO_Z / 400.0f);
+    if (id < MotorCount) return paraMm(id, motor.position(id)) / 10.0f;
+    return paraMm(MotorZ, motor.position(MotorZ)) / 10.0f;
+}
+
+//Retrato publicado pelo gerador de passos, convertido para mm
+extern "C" void Pipetadora_GetTelemetry(Pipetadora_Telemetria* t) {
+    StepEngine::Retrato r;
+    motor.snapshot(r);
+    for (int i = 0; i < STEP_EIXOS; ++i) t->mm[i] = paraMm(i, r.posicao[i]);
+    t->movendo = r.movendo;
+    t->emFila  = r.emFila;
 }
 
 //Retorna posição absoluta em passos da pipetadora (para X e Y) 
 int Pipetadora_GetPositionSteps(int id) {
-    return (id < MotorCount ? position[id] : positionZ);
+    return motor.position(id < MotorCount ? id : MotorZ);
 }
 
 // — Homing paralelo X e Y —
 static void HomingXY(void) {
-    stopTicker(MotorX);
-    stopTicker(MotorY);
-    Mover_Frente(MotorX);
-    Mover_Tras(MotorY);
-    while (tickerOn[MotorX] || tickerOn[MotorY]) {
-        if (!emergPin.read()) break;
-        ThisThread::sleep_for(1ms);
-    }
-    position[MotorX] = position[MotorY] = 0;
     Parar_Mov(MotorX);
     Parar_Mov(MotorY);
+    movFlags.clear((1u << MotorX) | (1u << MotorY));
+    Mover_Frente(MotorX);
+    Mover_Tras(MotorY);
+    // termina nos fins de curso ou na emergência (Pipetadora_Emergency)
+    movFlags.wait_all((1u << MotorX) | (1u << MotorY), osWaitForever, false);
+    motor.stop(MotorX);
+    motor.stop(MotorY);
+    motor.setPosition(MotorX, 0);
+    motor.setPosition(MotorY, 0);
 }
 
 // — Homing Z —
 static void homingZ(void) {
-    coilsZ = 0;
-    while (!endMaxZ->read()) {
-        if (!emergPin.read()) return;
-        stepZForward();
-        ThisThread::sleep_for(velStepMsZCurrent);
+    motor.setMinPeriod(MotorZ, periodoZ(velStepMsZCurrent));
+    movFlags.clear(1u << MotorZ);
+    Mover_Frente(MotorZ);
+    movFlags.wait_all(1u << MotorZ, osWaitForever, false);
+    if (!emergPin.read()) return;
+    motor.setPosition(MotorZ, 0);
+}
+
+//Aciona motor de passo no sentido horario (X, Y e Z)
+static void Mover_Frente(int id) {
+    motor.jog(id, 0);
+}
+//Aciona motor de passo no sentido antihorario (X, Y e Z)
+static void Mover_Tras(int id) {
+    motor.jog(id, 1);
+}
+
+//Para movimentação do eixo descendo a rampa de aceleração
+static void Parar_Mov(int id) {
+    motor.decelerate(id);
+}
+
+//Período de um evento do Z para um período por passo cheio (meio passo: metade)
+static microseconds periodoZ(microseconds porPasso) {
+    return porPasso * passoZ / 2;
+}
+
+//Rampa do Z em eventos da sequência atual, até a velocidade do automático
+static void montarRampaZ(void) {
+    int len = StepEngine::buildRamp(rampaZ, TAM_RAMPA_Z, periodoZ(PERIODO_INICIAL_Z),
+                                    periodoZ(PERIODO_Z_AUTO), ACELERACAO_Z * 2 / passoZ);
+    motor.setRamp(MotorZ, rampaZ, len, periodoZ(velStepMsZCurrent));
+}
+
+extern "C" void Pipetadora_SetZStepMode(Pipetadora_PassoZ modo) {
+    passoZ = (modo == Z_MEIO_PASSO) ? 1 : 2;
+    if (passoZ == 1) motor.setCoilSequence(MotorZ, SEQ_Z_MEIO, 8, passoZ);
+    else             motor.setCoilSequence(MotorZ, SEQ_Z, 4, passoZ);
+    montarRampaZ();
+}
+
+//Gera a curva S do próximo movimento: 'eventos' no eixo dominante e o
+//percurso de cada eixo (d) para escalar os limites para o eixo dominante;
+//escala converte unidades de posição do dominante em eventos
+static int gerarCurvaS(uint16_t* curva, uint32_t eventos, const int32_t d[STEP_EIXOS], int dominante,
+                       float escala = 1.0f) {
+    if (eventos == 0) return 0;
+    float vmax = 0.0f, amax = 0.0f, jmax = 0.0f;
+    for (int i = 0; i < STEP_EIXOS; ++i) {
+        if (d[i] == 0) continue;
+        const Pipetadora_Limites& l = limitesS[i][faseAtual];
+        float k = float(abs(d[dominante])) / float(abs(d[i]));  // eixo i anda 1/k do dominante
+        if (vmax == 0.0f || l.vmax * k < vmax) vmax = l.vmax * k;
+        if (amax == 0.0f || l.amax * k < amax) amax = l.amax * k;
+        if (jmax == 0.0f || l.jmax * k < jmax) jmax = l.jmax * k;
     }
-    coilsZ = 0;
-    positionZ = 0;
+    return StepEngine::buildSCurve(curva, TAM_CURVA, eventos,
+                                   vmax * escala, amax * escala, jmax * escala);
+}
+
+extern "C" void Pipetadora_SetProfile(Pipetadora_Perfil perfil) {
+    perfilAtual = perfil;
+}
+
+extern "C" void Pipetadora_SetPhase(Pipetadora_Fase fase) {
+    faseAtual = fase;
 }
 
-//Aciona ticked do motor de passo
-static void startTicker(int id) {
-    if (!tickerOn[id]) {
-        tickers[id]->attach(stepWrapper[id], periodCur[id]);
-        tickerOn[id] = true;
-        enableOut[id]->write(0);
+//Com a fila rodando o gerador lê rampaCheia na ISR: a tabela só é refeita parada
+extern "C" bool Pipetadora_SetLimits(int id, Pipetadora_Fase fase, Pipetadora_Limites lim) {
+    if (id < 0 || id >= STEP_EIXOS) return false;
+    if (fase != PONTEIRA_VAZIA && fase != PONTEIRA_CHEIA) return false;
+    if (motor.queueBusy()) return false;
+    limitesS[id][fase] = lim;
+    if (fase == PONTEIRA_CHEIA && id < MotorCount) montarRampaCheia(id);
+    return true;
+}
+
+//Rampa da ponteira cheia: aceleração e velocidade dos limites da fase cheia
+static void montarRampaCheia(int id) {
+    const Pipetadora_Limites& l = limitesS[id][PONTEIRA_CHEIA];
+    microseconds minimo = microseconds(int(1e6f / l.vmax));
+    if (minimo < PERIODO_MINIMO_FAST[id]) minimo = PERIODO_MINIMO_FAST[id];
+    int len = StepEngine::buildRamp(rampaCheia[id], TAM_RAMPA, PERIODO_INICIAL[id],
+                                    minimo, l.amax);
+    planner.setAxis(id, PONTEIRA_CHEIA, rampaCheia[id], len,
+                    1e6f / PERIODO_INICIAL[id].count(), l.amax);
+}
+
+//Aviso do gerador (contexto de ISR): eixo id parou ou, com STEP_FILA, a fila terminou
+static void movimentoConcluido(int id, bool falha) {
+    if (falha) movFlags.set(FLAG_FALHA);
+    uint32_t f = movFlags.set(1u << id);
+    if (f & osFlagsError) return;
+    for (int i = 0; i < STEP_EIXOS; ++i) {
+        Pipetadora_Callback cb = callbackEixo[i];
+        if (cb && (f & handleEixo[i]) == handleEixo[i]) {
+            callbackEixo[i] = nullptr;
+            cb(handleEixo[i], !(f & FLAG_FALHA));
+        }
     }
 }
 
-//Desativa ticked do motor de passo
-static void stopTicker(int id) {
-    if (tickerOn[id]) {
-        tickers[id]->detach();
-        tickerOn[id] = false;
-        enableOut[id]->write(1);
+//Registra um movimento assíncrono nos eixos de h; false se a emergência está ativa
+static bool iniciarMovimento(Pipetadora_Handle h, Pipetadora_Callback cb) {
+    {
+        CriticalSectionLock lock;
+        movFlags.clear(h | FLAG_FALHA);
+        int dono = 0;
+        while (!(h & (1u << dono))) ++dono;
+        callbackEixo[dono] = cb;
+        handleEixo  [dono] = h;
+    }
+    if (emergPin.read()) return true;
+    movFlags.set(FLAG_FALHA);
+    for (int i = 0; i < STEP_EIXOS; ++i) {
+        if (h & (1u << i)) movimentoConcluido(i, false);
     }
+    return false;
 }
 
-//ISR dos steps para os motores X e Y
-static void stepISR(int id) {
-    // parar no fim de curso
-    if ((dirState[id]==0 && endMax[id]->read()) ||
-        (dirState[id]==1 && endMin[id]->read())) {
-        stopTicker(id);
-        return;
+//Eixos do movimento que nem chegaram a partir (já no alvo) contam como concluídos
+static void concluirParados(Pipetadora_Handle h) {
+    for (int i = 0; i < STEP_EIXOS; ++i) {
+        if ((h & (1u << i)) && !motor.running(i)) movimentoConcluido(i, false);
     }
-    // gera pulso de step
-    bool st = !stepOut[id]->read();
-    stepOut[id]->write(st);
-    if (st) {
-        position[id] += (dirState[id]==0 ? +2 : -2);
+}
+
+//Interpolação de Bresenham para a pipetagem automatica
+extern "C" Pipetadora_Handle Pipetadora_MoveLinearAsync(int tx, int ty, Pipetadora_Callback cb) {
+    const Pipetadora_Handle h = (1u << MotorX) | (1u << MotorY);
+    if (!iniciarMovimento(h, cb)) return h;
+    if (perfilAtual == PERFIL_CURVA_S) {
+        int32_t d[STEP_EIXOS] = { tx - motor.position(MotorX), ty - motor.position(MotorY), 0 };
+        int dom = (abs(d[MotorX]) >= abs(d[MotorY])) ? MotorX : MotorY;
+        // bordas do eixo dominante: 2 por passo do driver
+        uint32_t eventos = 2 * ((abs(d[dom]) + 1) / 2);
+        int len = gerarCurvaS(curvaXY, eventos, d, dom);
+        motor.moveLinear(tx, ty, curvaXY, len);
+    } else {
+        motor.moveLinear(tx, ty);
     }
-    // aceleração / desaceleração
-    if (++passoCount[id] >= PASSOS_PARA_ACELERAR) {
-        passoCount[id] = 0;
-        if (periodCur[id] > periodoMinAtual[id]) {
-            // acelerar
-            periodCur[id] -= REDUCAO_PERIODO[id];
-            if (periodCur[id] < periodoMinAtual[id]) {
-                periodCur[id] = periodoMinAtual[id];
-            }
-        }
-        else if (periodCur[id] < periodoMinAtual[id]) {
-            // desacelerar
-            periodCur[id] += REDUCAO_PERIODO[id];
-            if (periodCur[id] > periodoMinAtual[id]) {
-                periodCur[id] = periodoMinAtual[id];
-            }
-        }
-        // atualiza ticker
-        tickers[id]->detach();
-        tickers[id]->attach(stepWrapper[id], periodCur[id]);
-        tickerOn[id] = true;
+    concluirParados(h);
+    return h;
+}
+
+//Move um eixo da pipetadora para a posição do ponto, sem esperar
+extern "C" Pipetadora_Handle Pipetadora_MoveToAsync(int id, int targetSteps, Pipetadora_Callback cb) {
+    if (id >= MotorCount) {
+        id = MotorZ;
+        motor.setMinPeriod(MotorZ, periodoZ(PERIODO_Z_AUTO));
+    }
+    const Pipetadora_Handle h = 1u << id;
+    if (!iniciarMovimento(h, cb)) return h;
+    if (perfilAtual == PERFIL_CURVA_S) {
+        int32_t d[STEP_EIXOS] = { 0, 0, 0 };
+        d[id] = targetSteps - motor.position(id);
+        uint32_t eventos = abs(d[id]);
+        float escala = 1.0f;
+        if (id != MotorZ) eventos = (eventos + 1) & ~1u;
+        else { eventos = (eventos + passoZ - 1) / passoZ; escala = 1.0f / passoZ; }
+        uint16_t* curva = (id == MotorZ) ? curvaZ : curvaXY;
+        motor.moveTo(id, targetSteps, curva, gerarCurvaS(curva, eventos, d, id, escala));
+    } else {
+        motor.moveTo(id, targetSteps);
     }
+    // o fim de curso superior do Z re-referencia o eixo no próprio gerador
+    concluirParados(h);
+    return h;
 }
 
-//Aciona motor de passo no sentido horario (X e Y)
-static void Mover_Frente(int id) {
-    if (endMax[id]->read()) return;
-    dirState[id]   = 0;
-    dirOut[id]->write(0);
-    enableOut[id]->write(0);
-    periodCur[id]  = PERIODO_INICIAL[id];
-    passoCount[id] = 0;
-    startTicker(id);
-}
-//Aciona motor de passo no sentido antihorario (X e Y)
-static void Mover_Tras(int id) {
-    if (endMin[id]->read()) return;
-    dirState[id]   = 1;
-    dirOut[id]->write(1);
-    enableOut[id]->write(0);
-    periodCur[id]  = PERIODO_INICIAL[id];
-    passoCount[id] = 0;
-    startTicker(id);
+//Espera o movimento do handle sem polling: acorda no aviso do gerador
+extern "C" bool Pipetadora_Wait(Pipetadora_Handle h) {
+    movFlags.wait_all(h, osWaitForever, false);
+    return !(movFlags.get() & FLAG_FALHA);
 }
 
-//Para movimentação de X e Y
-static void Parar_Mov(int id) {
-    stopTicker(id);
+extern "C" bool Pipetadora_IsDone(Pipetadora_Handle h) {
+    return (movFlags.get() & h) == h;
 }
 
-//Interpolação de Bresenham para a pipetagem automatica
 extern "C" void Pipetadora_MoveLinear(int tx, int ty) {
-    lin_x0 = position[MotorX]; lin_y0 = position[MotorY];
-    lin_tx = tx;              lin_ty = ty;
-    lin_dx = abs(lin_tx - lin_x0);
-    lin_dy = abs(lin_ty - lin_y0);
-    lin_sx = (lin_tx > lin_x0 ? 1 : -1);
-    lin_sy = (lin_ty > lin_y0 ? 1 : -1);
-    lin_err = lin_dx - lin_dy;
-
-    enableOut[MotorX]->write(0);
-    enableOut[MotorY]->write(0);
-    dirOut[MotorX]->write(lin_sx < 0);
-    dirOut[MotorY]->write(lin_sy < 0);
-
-    tickers[MotorX]->detach();
-    tickers[MotorY]->detach();
-    tickerOn[MotorX] = tickerOn[MotorY] = true;
-    tickers[MotorX]->attach(stepLinearX_wrapper, INTERP_PERIOD);
-    tickers[MotorY]->attach(stepLinearY_wrapper, INTERP_PERIOD);
-
-    while (tickerOn[MotorX] || tickerOn[MotorY]) {
-        if (!emergPin.read()) break;
-        ThisThread::sleep_for(1ms);
-    }
+    Pipetadora_Wait(Pipetadora_MoveLinearAsync(tx, ty, NULL));
+}
+
+extern "C" void Pipetadora_MoveTo(int id, int targetSteps) {
+    Pipetadora_Wait(Pipetadora_MoveToAsync(id, targetSteps, NULL));
+}
+
+extern "C" void Pipetadora_StartMoveZ(int z) {
+    Pipetadora_MoveToAsync(MotorZ, z, NULL);
+}
 
-    enableOut[MotorX]->write(1);
-    enableOut[MotorY]->write(1);
+extern "C" bool Pipetadora_IsMoving(int id) {
+    return motor.running(id < MotorCount ? id : MotorZ);
 }
 
-//Definição do step em Bresenham para X 
-static void stepLinearX() {
-    if (lin_x0 == lin_tx && lin_y0 == lin_ty) {
-        tickers[MotorX]->detach();
-        tickerOn[MotorX] = false;
-        enableOut[MotorX]->write(1);
-        return;
+//Fila vazia e gerador parado: os trechos partem da posição atual
+static void prepararFila(void) {
+    if (planner.empty() && !motor.queueBusy()) {
+        planner.setStart(motor.position(MotorX), motor.position(MotorY), motor.position(MotorZ));
     }
-    int e2 = lin_err * 2;
-    if (e2 > -lin_dy) {
-        stepOut[MotorX]->write(!stepOut[MotorX]->read());
-        lin_x0 += lin_sx;
-        position[MotorX] = lin_x0;
-        lin_err -= lin_dy;
+}
+
+extern "C" void Pipetadora_QueueLinear(int tx, int ty) {
+    prepararFila();
+    for (int i = 0; i < MotorCount; ++i) planner.setMinPeriod(i, periodoMinAtual[i]);
+    planner.pushLinear(tx, ty, faseAtual);
+}
+
+extern "C" void Pipetadora_QueueMoveZ(int z) {
+    prepararFila();
+    planner.pushZ(z);
+}
+
+//Mesmo pulso de Pipetadora_ActuateValve, temporizado pelo gerador
+extern "C" void Pipetadora_QueueValve(void) {
+    prepararFila();
+    planner.pushPin(0);
+    planner.pushDwell(50ms);
+    planner.pushPin(1);
+}
+
+//Altura segura do Z: acima dela a ponteira não colide durante o XY
+extern "C" void Pipetadora_SetSafeHeight(int z) {
+    motor.setSafeHeight(z > 0 ? 0 : z);
+}
+
+//Deslocamento coordenado: Z sobe ao topo, o XY parte assim que o Z passa da
+//altura segura e a descida começa na desaceleração final do XY, retida na
+//altura segura até o XY chegar
+extern "C" void Pipetadora_QueueTravel(int tx, int ty, int z) {
+    prepararFila();
+    for (int i = 0; i < MotorCount; ++i) planner.setMinPeriod(i, periodoMinAtual[i]);
+    planner.pushZ(0);
+    planner.pushLinear(tx, ty, faseAtual, true);
+    planner.pushZ(z, true);
+}
+
+extern "C" void Pipetadora_QueueDwell(int ms) {
+    prepararFila();
+    planner.pushDwell(milliseconds(ms));
+}
+
+//Planeja as junções e roda a fila inteira sem voltar à thread entre trechos
+extern "C" bool Pipetadora_RunQueue(void) {
+    if (!emergPin.read()) { planner.clear(); return false; }
+    motor.setMinPeriod(MotorZ, periodoZ(PERIODO_Z_AUTO));
+    movFlags.clear(FLAG_FILA | FLAG_FALHA);
+    {
+        PERFIL_MEDIR(perfPlano);
+        planner.plan();
     }
-    tickers[MotorX]->detach();
-    tickers[MotorX]->attach(stepLinearX_wrapper, INTERP_PERIOD);
+    filaIniciada = true;
+    motor.runQueue();
+    return Pipetadora_WaitQueue();
+}
+
+extern "C" int Pipetadora_QueueSpace(void) {
+    return planner.space();
 }
 
-//Definição do step em Bresenham para Y
-static void stepLinearY() {
-    if (lin_x0 == lin_tx && lin_y0 == lin_ty) {
-        tickers[MotorY]->detach();
-        tickerOn[MotorY] = false;
-        enableOut[MotorY]->write(1);
-        return;
+//Replaneja com o gerador rodando; se ele parou (fim dos trechos prontos, mesmo
+//durante o plan()), parte de novo com os que chegaram
+extern "C" bool Pipetadora_StartQueue(void) {
+    if (!emergPin.read()) { planner.clear(); return false; }
+    {
+        PERFIL_MEDIR(perfPlano);
+        planner.plan();
     }
-    int e2 = lin_err * 2;
-    if (e2 < lin_dx) {
-        stepOut[MotorY]->write(!stepOut[MotorY]->read());
-        lin_y0 += lin_sy;
-        position[MotorY] = lin_y0;
-        lin_err += lin_dx;
+    if (motor.queueBusy() || planner.empty()) return true;
+    if (filaIniciada && motor.queueFault()) {
+        // sobras da fila interrompida por fim de curso
+        filaIniciada = false;
+        planner.clear();
+        return false;
     }
-    tickers[MotorY]->detach();
-    tickers[MotorY]->attach(stepLinearY_wrapper, INTERP_PERIOD);
+    motor.setMinPeriod(MotorZ, periodoZ(PERIODO_Z_AUTO));
+    movFlags.clear(FLAG_FILA | FLAG_FALHA);
+    filaIniciada = true;
+    motor.runQueue();
+    return true;
 }
 
-static void stepLinearX_wrapper() { stepLinearX(); }
-static void stepLinearY_wrapper() { stepLinearY(); }
+extern "C" bool Pipetadora_WaitQueue(void) {
+    movFlags.wait_all(FLAG_FILA, osWaitForever, false);
+    bool ok = !(filaIniciada && motor.queueFault());
+    filaIniciada = false;
+    if (!ok) planner.clear();
+    return ok;
+}
 
-//Move ambos os eixos da pipetadora para a posição dos pontos
-extern "C" void Pipetadora_MoveTo(int id, int targetSteps) {
-    if (id < MotorCount) {
-        int32_t current = position[id];
-        int32_t delta   = targetSteps - current;
-        if (delta > 0) {
-            Mover_Frente(id);
-            while (position[id] < targetSteps) {
-                if (!emergPin.read()) return;
-                ThisThread::sleep_for(1ms);
-            }
-            Parar_Mov(id);
-        } else if (delta < 0) {
-            Mover_Tras(id);
-            while (position[id] > targetSteps) {
-                if (!emergPin.read()) return;
-                ThisThread::sleep_for(1ms);
-            }
-            Parar_Mov(id);
-        }
-    } else {
-        int32_t delta = targetSteps - positionZ;
-        if (delta > 0) {
-            while (positionZ < targetSteps) {
-                if (!emergPin.read()) return;
-                if (endMaxZ->read()) { positionZ = 0; break; }
-                stepZForward();
-                ThisThread::sleep_for(VEL_STEP_MS_Z_HIGH);
-            }
-        } else if (delta < 0) {
-            while (positionZ > targetSteps) {
-                if (!emergPin.read()) { coilsZ = 0; return; }
-                if (endMinZ->read()) break;
-                stepZBackward();
-                ThisThread::sleep_for(VEL_STEP_MS_Z_HIGH);
-            }
-        }
-        coilsZ = 0;
-    }
+//Inversa de paraMm
+extern "C" int Pipetadora_MmToSteps(int id, float mm) {
+    if (id < MotorCount) return int(lroundf(mm * 400.0f / (PASSO_FUSO[id] * 10.0f)));
+    return int(lroundf(mm * 800.0f / (PASSO_FUSO_Z * 10.0f)));
 }
 
 //Ativação da pipeta
 extern "C" void Pipetadora_ActuateValve(int volume_ml) {
     if (!emergPin.read()) return;
     pipette->write(0);
+    Registro_Gravar(REG_VALVULA, REGISTRO_SEM_EIXO, 0, 0, 0);
     ThisThread::sleep_for(50ms);
     pipette->write(1);
+    Registro_Gravar(REG_VALVULA, REGISTRO_SEM_EIXO, 1, 0, 0);
 }
 
 //Para todos os motores
 extern "C" void Pipetadora_StopAll(void) {
-    Parar_Mov(MotorX);
-    Parar_Mov(MotorY);
-    coilsZ = 0;
+    motor.stopAll();
+    planner.clear();
+    pipette->write(0);
+}
+
+// — Captura das bordas de passo —
+#if STEP_TRACE
+static Pipetadora_RefCaptura refCaptura;
+#endif
+
+extern "C" bool Pipetadora_TraceStart(Pipetadora_RefCaptura* ref) {
+#if STEP_TRACE
+    refCaptura.hz = SystemCoreClock;
+    motor.traceStart(refCaptura.ciclos, refCaptura.us);
+    if (ref) *ref = refCaptura;
+    return true;
+#else
+    (void) ref;
+    return false;
+#endif
+}
+
+extern "C" int Pipetadora_TraceRead(Pipetadora_Marca* dst, int max, uint32_t* perdidas) {
+#if STEP_TRACE
+    StepEngine::Marca buf[32];
+    uint32_t p = 0;
+    int total = 0;
+    while (total < max) {
+        int n = motor.traceRead(buf, (max - total < 32) ? max - total : 32, p);
+        for (int i = 0; i < n; ++i) {
+            Pipetadora_Marca& m = dst[total + i];
+            m.ciclos = buf[i].ciclos;
+            m.prazo  = buf[i].prazo;
+            m.eixo   = buf[i].eixo;
+            m.passo  = buf[i].passo;
+        }
+        total += n;
+        if (n == 0) break;
+    }
+    if (perdidas) *perdidas += p;
+    return total;
+#else
+    (void) dst;
+    (void) max;
+    (void) perdidas;
+    return 0;
+#endif
+}
+
+//Formato lido pelo analisador do simulador (simulador passos <arquivo>)
+extern "C" void Pipetadora_TraceDump(void) {
+#if STEP_TRACE
+    printf("#passos %lu %lu %lu\n", (unsigned long)refCaptura.hz,
+           (unsigned long)refCaptura.ciclos, (unsigned long)refCaptura.us);
+    Pipetadora_Marca m[32];
+    uint32_t perdidas = 0;
+    int n;
+    while ((n = Pipetadora_TraceRead(m, 32, &perdidas)) > 0) {
+        for (int i = 0; i < n; ++i) {
+            printf("%u %u %lu %lu\n", m[i].eixo, m[i].passo,
+                   (unsigned long)m[i].ciclos, (unsigned long)m[i].prazo);
+        }
+    }
+    if (perdidas) printf("#perdidas %lu\n", (unsigned long)perdidas);
+#endif
+}
+
+//Parada de emergência chamada pela ISR do botão: para os eixos na hora e acorda
+//quem espera um movimento (a fila é limpa depois, na thread)
+extern "C" void Pipetadora_Emergency(void) {
+    Registro_Gravar(REG_EMERGENCIA, REGISTRO_SEM_EIXO, 1, 0, 0);
+    motor.stopAll();
     pipette->write(0);
+    movFlags.set(FLAG_FALHA);
+    movFlags.set(FLAGS_EIXOS | FLAG_FILA);
 }
@@ -2,12 +2,27 @@
 #ifndef PIPETADORA_H
 #define PIPETADORA_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Identifica um movimento assíncrono: um bit por eixo envolvido (1<<id)
+typedef unsigned int Pipetadora_Handle;
+// Aviso de conclusão (ok=false → emergência ou fim de curso); roda em contexto de ISR
+typedef void (*Pipetadora_Callback)(Pipetadora_Handle h, bool ok);
+
 // Move X e Y simultaneamente em linha reta até (tx,ty)
 void  Pipetadora_MoveLinear(int tx, int ty);
+// Versões assíncronas: retornam na hora; cb (opcional) é chamada na conclusão
+Pipetadora_Handle Pipetadora_MoveLinearAsync(int tx, int ty, Pipetadora_Callback cb);
+Pipetadora_Handle Pipetadora_MoveToAsync(int id, int targetSteps, Pipetadora_Callback cb);
+// Bloqueia até o movimento terminar, sem polling; false em emergência ou fim de curso
+bool  Pipetadora_Wait(Pipetadora_Handle h);
+// Indica se o movimento já terminou
+bool  Pipetadora_IsDone(Pipetadora_Handle h);
 // Inicializa GPIO, tickers e variáveis internas de motores e pipeta
 void  Pipetadora_InitMotors(void);
 // Executa rotina de homing (referenciamento) dos eixos X, Y e Z
@@ -16,14 +31,115 @@ void  Pipetadora_Homing(void);
 void  Pipetadora_ManualControl(void);
 // Retorna posição (em cm) do eixo especificado (0=X, 1=Y, 2=Z)
 float Pipetadora_GetPositionCm(int id);
-// Retorna posição (em passos) do eixo especificado (0=X, 1=Y, 2=Z)
+// Retorna posição (em passos; Z em meios passos) do eixo especificado (0=X, 1=Y, 2=Z)
 int   Pipetadora_GetPositionSteps(int id);
+
+// Retrato do movimento para a tela de status
+typedef struct {
+    float    mm[3];      // posição de X, Y e Z em mm
+    unsigned movendo;    // um bit por eixo em movimento (1<<id)
+    bool     emFila;     // executando a fila de trechos (pipetagem automática)
+} Pipetadora_Telemetria;
+
+// Lê as posições dos três eixos num mesmo instante, sem travar o gerador de passos
+void  Pipetadora_GetTelemetry(Pipetadora_Telemetria* t);
 // Move o eixo (0=X,1=Y,2=Z) até a posição especificada em passos
 void  Pipetadora_MoveTo(int id, int targetSteps);
+// Inicia o movimento do Z até z e retorna em seguida (não bloqueante)
+void  Pipetadora_StartMoveZ(int z);
+// Indica se o eixo (0=X,1=Y,2=Z) ainda está em movimento
+bool  Pipetadora_IsMoving(int id);
 // Aciona a válvula da pipeta para o volume em mL (bloqueante)
 void  Pipetadora_ActuateValve(int volume_ml);
 // Para imediatamente todos os movimentos e desativa bobinas (emergência)
 void  Pipetadora_StopAll(void);
+// Mesma parada, chamada da ISR do botão de emergência; acorda Wait/RunQueue
+void  Pipetadora_Emergency(void);
+
+// Perfil de velocidade usado por MoveLinear e MoveTo
+typedef enum {
+    PERFIL_TRAPEZIO = 0,   // aceleração constante (padrão)
+    PERFIL_CURVA_S  = 1    // jerk limitado, para ponteira com líquido
+} Pipetadora_Perfil;
+
+// Fase da ponteira: cada fase tem seus próprios limites de movimento
+typedef enum {
+    PONTEIRA_VAZIA = 0,
+    PONTEIRA_CHEIA = 1
+} Pipetadora_Fase;
+
+// Limites do perfil S em passos/s, passos/s² e passos/s³ (passos de GetPositionSteps)
+typedef struct {
+    float vmax;
+    float amax;
+    float jmax;
+} Pipetadora_Limites;
+
+// Sequência das bobinas do Z: meio passo dobra a resolução e suaviza altas velocidades
+typedef enum {
+    Z_PASSO_CHEIO = 0,   // SEQ_Z (padrão)
+    Z_MEIO_PASSO  = 1    // SEQ_Z_MEIO
+} Pipetadora_PassoZ;
+
+// Troca a sequência do Z (com o eixo parado; a posição não muda)
+void  Pipetadora_SetZStepMode(Pipetadora_PassoZ modo);
+// Seleciona o perfil de velocidade dos próximos movimentos
+void  Pipetadora_SetProfile(Pipetadora_Perfil perfil);
+// Informa se a ponteira está vazia ou carregada
+void  Pipetadora_SetPhase(Pipetadora_Fase fase);
+// Ajusta os limites do perfil S de um eixo (0=X, 1=Y, 2=Z) numa fase; false
+// (nada muda) com eixo ou fase inválidos ou com a fila rodando
+bool  Pipetadora_SetLimits(int id, Pipetadora_Fase fase, Pipetadora_Limites lim);
+
+// Fila de movimentos: os trechos enfileirados são executados em sequência pelo
+// gerador de passos, com velocidade nas junções entre trechos XY consecutivos
+// (limites da fase da ponteira no momento em que o trecho é enfileirado)
+void  Pipetadora_QueueLinear(int tx, int ty);
+void  Pipetadora_QueueMoveZ(int z);
+// Pulso da válvula da pipeta (mesmo tempo de Pipetadora_ActuateValve)
+void  Pipetadora_QueueValve(void);
+// Altura Z (passos; 0 = topo) acima da qual a ponteira não colide com nada
+void  Pipetadora_SetSafeHeight(int z);
+// Deslocamento coordenado até (tx,ty,z): o XY parte assim que o Z sobe além da
+// altura segura e o Z desce já na desaceleração final do XY, sem passar da
+// altura segura enquanto o XY anda
+void  Pipetadora_QueueTravel(int tx, int ty, int z);
+// Pausa entre trechos, em ms
+void  Pipetadora_QueueDwell(int ms);
+// Executa a fila até o fim (bloqueante); false se parou por emergência ou fim de curso
+bool  Pipetadora_RunQueue(void);
+// Fila contínua (terminal serial): trechos enfileirados enquanto o gerador roda.
+// Espaço livre em trechos (QueueTravel e QueueValve usam 3, os outros 1)
+int   Pipetadora_QueueSpace(void);
+// Planeja os trechos novos e põe o gerador a rodar se estiver parado, sem esperar;
+// false (fila limpa) com a emergência apertada ou se a fila parou por fim de curso
+bool  Pipetadora_StartQueue(void);
+// Espera a fila esvaziar; false se parou por emergência ou fim de curso
+bool  Pipetadora_WaitQueue(void);
+// Converte mm em passos (Z em meios passos) do eixo (0=X, 1=Y, 2=Z)
+int   Pipetadora_MmToSteps(int id, float mm);
+
+// Captura das bordas de passo (instrumentação; STEP_TRACE 1 em StepEngine.h)
+typedef struct {
+    uint32_t ciclos;   // DWT->CYCCNT na borda
+    uint32_t prazo;    // instante planejado da borda (us do ticker, 32 bits)
+    uint8_t  eixo;     // 0=X, 1=Y, 2=Z
+    uint8_t  passo;    // 1 → a borda andou o eixo (subida do STEP, troca de bobina)
+} Pipetadora_Marca;
+
+// Referência lida num mesmo instante para converter ciclos no tempo do ticker
+typedef struct {
+    uint32_t hz;       // SystemCoreClock
+    uint32_t ciclos;
+    uint32_t us;
+} Pipetadora_RefCaptura;
+
+// Esvazia o buffer e recomeça a captura; false se compilado sem STEP_TRACE
+bool  Pipetadora_TraceStart(Pipetadora_RefCaptura* ref);
+// Copia até max bordas ainda não lidas; *perdidas soma as sobrescritas antes da leitura
+int   Pipetadora_TraceRead(Pipetadora_Marca* dst, int max, uint32_t* perdidas);
+// Escreve no console as bordas ainda não lidas, uma por linha, após a referência
+void  Pipetadora_TraceDump(void);
 
 // Retorna o modo de toggle manual:
 //   false → X/Y   |   true → Z/Y
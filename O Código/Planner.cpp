@@ -0,0 +1,202 @@
+#include "Planner.h"
+#include "StepEngine.h"
+
+using namespace std::chrono;
+
+Planner::Planner() : _cabeca(0), _prontos(0), _cauda(0), _inicio(0) {
+    _minimo[0] = _minimo[1] = microseconds(0);
+    _salto[0]  = _salto[1]  = 0.0f;
+    _pos[0] = _pos[1] = _pos[2] = 0;
+}
+
+void Planner::setAxis(int id, int fase, const uint16_t* tab, int len, float v0, float aceleracao) {
+    Eixo& e = _eixo[fase][id];
+    e.tab = tab;
+    e.len = len;
+    e.v0  = v0;
+    e.a   = aceleracao;
+    // o motor parte do repouso direto em v0: esse é o salto aceito numa junção
+    if (fase == 0) _salto[id] = v0;
+}
+
+void Planner::setMinPeriod(int id, microseconds minimo) {
+    _minimo[id] = minimo;
+}
+
+void Planner::setStart(int32_t x, int32_t y, int32_t z) {
+    _pos[0] = x;
+    _pos[1] = y;
+    _pos[2] = z;
+}
+
+void Planner::clear() {
+    CriticalSectionLock lock;
+    _cabeca = _prontos = _cauda;
+    _inicio = _cauda;
+}
+
+//Reserva o próximo espaço da fila; um espaço fica livre para o trecho em execução
+Segmento* Planner::push(Segmento::Tipo tipo) {
+    if (full()) return nullptr;
+    Segmento* s = &_fila[_cauda % FILA_TAM];
+    s->tipo     = tipo;
+    s->sobrepor = false;
+    s->tab      = nullptr;
+    s->tabMax   = s->entrada = s->saida = 0;
+    s->eventos  = 0;
+    s->vJuncao  = s->vSaida = 0.0f;
+    return s;
+}
+
+bool Planner::pushLinear(int32_t tx, int32_t ty, int fase, bool sobrepor) {
+    Segmento* s = push(Segmento::XY);
+    if (!s) return false;
+    s->sobrepor = sobrepor;
+    s->alvo[0] = tx;
+    s->alvo[1] = ty;
+
+    // mesmas contas do StepEngine::moveLinear: 2 eventos (bordas) por passo
+    float e[2];
+    int32_t passos[2];
+    for (int i = 0; i < 2; ++i) {
+        int32_t d = s->alvo[i] - _pos[i];
+        passos[i] = (abs(d) + 1) / 2;
+        e[i] = (d >= 0 ? 2.0f : -2.0f) * passos[i];
+        _pos[i] += int32_t(e[i]);   // o driver anda 2 por passo, como no gerador
+    }
+    int m = (passos[0] >= passos[1]) ? 0 : 1;
+    s->mestre  = m;
+    s->eventos = 2 * passos[m];
+    if (s->eventos > 0) {
+        const Eixo& eixo = _eixo[fase][m];
+        float L = sqrtf(e[0] * e[0] + e[1] * e[1]);
+        s->u[0]   = e[0] / L;
+        s->u[1]   = e[1] / L;
+        s->k      = s->eventos / L;
+        s->tab    = eixo.tab;
+        s->v02    = eixo.v0 * eixo.v0;
+        s->a      = eixo.a;
+        int lim   = StepEngine::rampIndex(eixo.tab, eixo.len, _minimo[m]);
+        s->tabMax = uint16_t(lim);
+
+        // junção com o trecho XY anterior: cada eixo aceita um salto de velocidade
+        // de até _salto, como na partida do repouso
+        if (_cauda != _inicio) {
+            const Segmento& a = _fila[(_cauda - 1) % FILA_TAM];
+            if (a.tipo == Segmento::XY && a.eventos > 0) {
+                float v = speedOf(a, a.tabMax);
+                float vs = speedOf(*s, s->tabMax);
+                if (vs < v) v = vs;
+                for (int i = 0; i < 2; ++i) {
+                    float du = fabsf(a.u[i] - s->u[i]);
+                    if (du > 1e-6f && _salto[i] / du < v) v = _salto[i] / du;
+                }
+                s->vJuncao = v;
+            }
+        }
+    }
+    ++_cauda;
+    return true;
+}
+
+bool Planner::pushZ(int32_t tz, bool sobrepor) {
+    Segmento* s = push(Segmento::Z);
+    if (!s) return false;
+    s->sobrepor = sobrepor;
+    s->alvo[0] = tz;
+    _pos[2] = tz;
+    ++_cauda;
+    return true;
+}
+
+bool Planner::pushPin(int nivel) {
+    Segmento* s = push(Segmento::PINO);
+    if (!s) return false;
+    s->alvo[0] = nivel;
+    ++_cauda;
+    return true;
+}
+
+bool Planner::pushDwell(microseconds t) {
+    Segmento* s = push(Segmento::ESPERA);
+    if (!s) return false;
+    s->alvo[0] = int32_t(t.count());
+    ++_cauda;
+    return true;
+}
+
+//Índice da tabela do dominante cuja velocidade não passa de v (velocidade de percurso)
+int Planner::indexOf(const Segmento& s, float v) const {
+    float vm = v * s.k;
+    float i  = (vm * vm - s.v02) / (2.0f * s.a);
+    if (i <= 0.0f) return 0;
+    if (i >= s.tabMax) return s.tabMax;
+    return int(i);
+}
+
+//Velocidade de percurso correspondente ao índice idx da tabela do dominante
+float Planner::speedOf(const Segmento& s, int idx) const {
+    if (idx > s.tabMax) idx = s.tabMax;
+    return sqrtf(s.v02 + 2.0f * s.a * idx) / s.k;
+}
+
+//Passadas para trás e para frente sobre os trechos ainda não iniciados: cada
+//trecho só pode ganhar ou perder (eventos-1) índices de rampa entre as junções
+void Planner::plan() {
+    static float v[FILA_TAM + 1];
+    for (;;) {
+        const uint32_t ini = _cabeca;
+        const uint32_t fim = _cauda;
+        const int n = int(fim - ini);
+        if (n == 0) return;
+
+        // junção de entrada fixa: saída já planejada do trecho em execução
+        float vIni = 0.0f;
+        if (ini != _inicio) {
+            const Segmento& a = _fila[(ini - 1) % FILA_TAM];
+            if (a.tipo == Segmento::XY) vIni = a.vSaida;
+        }
+        for (int j = 0; j < n; ++j) {
+            const Segmento& s = _fila[(ini + j) % FILA_TAM];
+            v[j] = (s.tipo == Segmento::XY && s.eventos > 0) ? s.vJuncao : 0.0f;
+        }
+        v[0] = vIni;
+        v[n] = 0.0f;
+
+        for (int j = n - 1; j >= 0; --j) {
+            const Segmento& s = _fila[(ini + j) % FILA_TAM];
+            if (s.tipo != Segmento::XY || s.eventos == 0) {
+                if (j > 0) v[j] = 0.0f;
+                continue;
+            }
+            float vMax = speedOf(s, indexOf(s, v[j + 1]) + int(s.eventos) - 1);
+            if (j > 0 && v[j] > vMax) v[j] = vMax;
+        }
+        for (int j = 0; j < n; ++j) {
+            const Segmento& s = _fila[(ini + j) % FILA_TAM];
+            if (s.tipo != Segmento::XY || s.eventos == 0) {
+                v[j + 1] = 0.0f;
+                continue;
+            }
+            float vMax = speedOf(s, indexOf(s, v[j]) + int(s.eventos) - 1);
+            if (v[j + 1] > vMax) v[j + 1] = vMax;
+        }
+
+        CriticalSectionLock lock;
+        if (_cabeca != ini) continue;   // a ISR iniciou um trecho durante o cálculo
+        for (int j = 0; j < n; ++j) {
+            Segmento& s = _fila[(ini + j) % FILA_TAM];
+            if (s.tipo != Segmento::XY || s.eventos == 0) continue;
+            int e  = indexOf(s, v[j]);
+            int sa = indexOf(s, v[j + 1]);
+            int N  = int(s.eventos) - 1;
+            if (sa > e + N) sa = e + N;
+            if (e > sa + N) e = sa + N;
+            s.entrada = uint16_t(e);
+            s.saida   = uint16_t(sa);
+            s.vSaida  = v[j + 1];
+        }
+        _prontos = fim;
+        return;
+    }
+}
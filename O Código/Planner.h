@@ -0,0 +1,91 @@
+// Planner.h
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include "mbed.h"
+
+// Capacidade da fila de trechos (um ciclo de aspirar/dispensar usa ~16)
+#define FILA_TAM 32
+
+// Trecho da fila de movimentos executado pelo StepEngine
+struct Segmento {
+    enum Tipo : uint8_t { XY, Z, PINO, ESPERA };
+
+    Tipo    tipo;
+    bool    sobrepor;        // XY parte com o Z acima da altura segura; Z desce
+                             // durante a desaceleração final do XY
+    int32_t alvo[2];         // XY: (x,y) | Z: z | PINO: nível | ESPERA: us
+
+    // resultado do planejamento (lido pela ISR)
+    const uint16_t* tab;     // tabela de aceleração do eixo dominante (XY)
+    uint16_t tabMax;         // maior índice permitido (velocidade de cruzeiro)
+    uint16_t entrada;        // índice de velocidade na junção de entrada
+    uint16_t saida;          // índice de velocidade na junção de saída
+
+    // dados de planejamento (só na thread)
+    uint8_t mestre;          // eixo dominante
+    uint32_t eventos;        // eventos do eixo dominante
+    float   k;               // eventos do dominante por unidade de percurso
+    float   u[2];            // direção unitária do trecho (em eventos)
+    float   v02, a;          // v0² e aceleração da tabela do dominante
+    float   vJuncao;         // velocidade máxima de percurso na junção de entrada
+    float   vSaida;          // velocidade de percurso planejada na saída
+};
+
+// Planejador com lookahead: guarda os trechos num buffer circular e calcula
+// as velocidades nas junções entre trechos XY consecutivos, de forma que o
+// gerador de passos encadeie os movimentos sem parar entre eles.
+// Produtor: thread que enfileira e chama plan(). Consumidor: ISR (peek/pop).
+class Planner {
+public:
+    Planner();
+
+    // Tabela de aceleração do eixo (0=X, 1=Y) para a fase da ponteira, com a
+    // velocidade inicial (eventos/s) e a aceleração (eventos/s²) que a geraram
+    void setAxis(int id, int fase, const uint16_t* tab, int len, float v0, float aceleracao);
+    // Período mínimo do eixo (seletor de velocidade) aplicado aos próximos trechos
+    void setMinPeriod(int id, std::chrono::microseconds minimo);
+    // Posição de partida do próximo trecho (fila vazia)
+    void setStart(int32_t x, int32_t y, int32_t z);
+
+    // Enfileiram um trecho; retornam false com a fila cheia
+    bool pushLinear(int32_t tx, int32_t ty, int fase, bool sobrepor = false);
+    bool pushZ(int32_t tz, bool sobrepor = false);
+    bool pushPin(int nivel);
+    bool pushDwell(std::chrono::microseconds t);
+
+    // Replaneja os trechos ainda não iniciados e os libera para o gerador
+    void plan();
+    void clear();
+    bool empty() const { return _cabeca == _cauda; }
+    bool full()  const { return _cauda - _cabeca >= FILA_TAM - 1; }
+    int  space() const { return int(FILA_TAM - 1 - (_cauda - _cabeca)); }
+
+    // Consumidor (ISR do StepEngine)
+    Segmento* peek() { return (_cabeca != _prontos) ? &_fila[_cabeca % FILA_TAM] : nullptr; }
+    void      pop()  { ++_cabeca; }
+
+private:
+    struct Eixo {
+        const uint16_t* tab = nullptr;
+        int   len = 0;
+        float v0  = 0.0f;
+        float a   = 1.0f;
+    };
+
+    Segmento* push(Segmento::Tipo tipo);
+    int   indexOf(const Segmento& s, float v) const;
+    float speedOf(const Segmento& s, int idx) const;
+
+    Eixo                      _eixo[2][2];      // [fase][eixo]
+    std::chrono::microseconds _minimo[2];
+    float                     _salto[2];        // salto de velocidade aceito por eixo
+    int32_t                   _pos[3];          // posição ao fim do último trecho
+    Segmento                  _fila[FILA_TAM];
+    volatile uint32_t         _cabeca;          // próximo trecho a executar (ISR)
+    volatile uint32_t         _prontos;         // trechos já planejados
+    volatile uint32_t         _cauda;           // próximo espaço livre (thread)
+    uint32_t                  _inicio;          // primeiro trecho após clear()
+};
+
+#endif // PLANNER_H
@@ -0,0 +1,194 @@
+#include "Protocolo.h"
+#include "Pipetadora.h"
+#include "SpscQueue.h"
+#include "Registro.h"
+
+using namespace std::chrono_literals;
+
+#define FOLGA_Z 800  //Folga (meios passos Z) acima do ponto mais alto durante o XY
+
+// Filas sem trava: comandos da interface e respostas do movimento
+static SpscQueue<Comando, 4> comandos;
+static SpscQueue<Status,  8> respostas;
+// Instruções do terminal serial
+static SpscQueue<Instrucao, 16> instrucoes;
+static volatile uint32_t executadas;
+static volatile bool     alarme;
+
+// Thread de movimento: roda acima da interface, que pode ficar presa no LCD
+static Thread movimento(osPriorityHigh, 2048, nullptr, "movimento");
+static constexpr uint32_t FLAG_COMANDO   = 1;
+static constexpr uint32_t FLAG_INSTRUCAO = 2;
+
+static void enviar(Status::Tipo tipo, bool ok, int ponto = 0, int feitos = 0) {
+    Status s = { tipo, ok, ponto, feitos };
+    // a interface consome a cada volta do menu; com a fila cheia, o progresso é descartável
+    while (!respostas.push(s) && tipo == Status::FIM) ThisThread::sleep_for(10ms);
+}
+
+// Comando que interrompeu o anterior; é executado logo em seguida
+static Comando proximo;
+static bool    temProximo = false;
+
+//Chegou comando novo? Ele interrompe o atual (normalmente um PARAR)
+static bool pedidoParada(void) {
+    if (!temProximo) temProximo = comandos.pop(proximo);
+    return temProximo;
+}
+
+//Jog manual até a interface mandar parar
+static void manual(void) {
+    while (!pedidoParada()) Pipetadora_ManualControl();
+    Pipetadora_StopAll();
+}
+
+//Pipetagem automática: cada ciclo de aspirar/dispensar vai inteiro para a fila
+static bool pipetar(const Comando& c) {
+    Pipetadora_SetPhase(PONTEIRA_VAZIA);
+    if (!Pipetadora_Wait(Pipetadora_MoveToAsync(2, 0, NULL))) return false;
+    // altura segura: folga acima do ponto mais alto ensinado
+    int zMax = c.coleta->pos[2];
+    for (int j = 0; j < c.numSolta; ++j) {
+        if (c.solta[j].pos[2] > zMax) zMax = c.solta[j].pos[2];
+    }
+    Pipetadora_SetSafeHeight(zMax + FOLGA_Z);
+    for (int j = 0; j < c.numSolta; ++j) {
+        for (int done = 0; done < c.volume[j]; ++done) {
+            if (pedidoParada()) return false;
+            enviar(Status::PROGRESSO, true, j, done);
+            Registro_Gravar(REG_FASE_INICIO, REGISTRO_SEM_EIXO, REG_CICLO, j, done);
+            // ciclo inteiro na fila: o gerador encadeia os trechos
+            // e sobrepõe subida/descida do Z ao XY
+            // Aspirar
+            Pipetadora_QueueTravel(c.coleta->pos[0], c.coleta->pos[1], c.coleta->pos[2]);
+            Pipetadora_QueueValve();
+            Pipetadora_QueueDwell(2000);
+            Pipetadora_SetPhase(PONTEIRA_CHEIA);
+            // Dispensar
+            Pipetadora_QueueTravel(c.solta[j].pos[0], c.solta[j].pos[1], c.solta[j].pos[2]);
+            Pipetadora_QueueValve();
+            Pipetadora_QueueDwell(1200);
+            Pipetadora_SetPhase(PONTEIRA_VAZIA);
+            bool ok = Pipetadora_RunQueue();
+            Registro_Gravar(REG_FASE_FIM, REGISTRO_SEM_EIXO, REG_CICLO, ok, 0);
+            if (!ok) return false;
+        }
+    }
+    return Pipetadora_Wait(Pipetadora_MoveToAsync(2, 0, NULL));
+}
+
+//Espera espaço para n trechos; enquanto isso a fila roda com o que já tem
+static bool reservar(int n) {
+    while (Pipetadora_QueueSpace() < n) {
+        if (!Pipetadora_StartQueue() || pedidoParada()) return false;
+        ThisThread::sleep_for(1ms);
+    }
+    return true;
+}
+
+static bool executar(const Instrucao& i) {
+    switch (i.tipo) {
+        case Instrucao::LINEAR:
+            if (!reservar(1)) return false;
+            Pipetadora_QueueLinear(i.alvo[0], i.alvo[1]);
+            break;
+        case Instrucao::Z:
+            if (!reservar(1)) return false;
+            Pipetadora_QueueMoveZ(i.alvo[2]);
+            break;
+        case Instrucao::DESLOCAR:
+            if (!reservar(3)) return false;
+            Pipetadora_QueueTravel(i.alvo[0], i.alvo[1], i.alvo[2]);
+            break;
+        case Instrucao::VALVULA:
+            if (!reservar(3)) return false;
+            Pipetadora_QueueValve();
+            break;
+        case Instrucao::PAUSA:
+            if (!reservar(1)) return false;
+            Pipetadora_QueueDwell(i.alvo[0]);
+            break;
+        case Instrucao::ESPERAR:
+            return Pipetadora_StartQueue() && Pipetadora_WaitQueue();
+        case Instrucao::HOMING:
+            if (!Pipetadora_StartQueue() || !Pipetadora_WaitQueue()) return false;
+            Pipetadora_Homing();
+            break;
+        case Instrucao::REARMAR:
+            break;
+    }
+    return true;
+}
+
+//Instruções do terminal: cada trecho entra na fila assim que chega, com o
+//gerador rodando, e o lookahead replaneja as junções com os que vêm atrás
+static bool executarInstrucoes(void) {
+    Instrucao i;
+    bool alguma = false;
+    while (!pedidoParada() && instrucoes.pop(i)) {
+        alguma = true;
+        if (i.tipo == Instrucao::REARMAR) alarme = false;
+        else if (!alarme && !executar(i)) alarme = true;
+        core_util_atomic_incr_u32(&executadas, 1);
+    }
+    if (alguma && !alarme && !Pipetadora_StartQueue()) alarme = true;
+    return alguma;
+}
+
+static bool proximoComando(Comando& c) {
+    if (!temProximo) return comandos.pop(c);
+    c = proximo;
+    temProximo = false;
+    return true;
+}
+
+static void threadMovimento(void) {
+    for (;;) {
+        Comando c;
+        while (!proximoComando(c)) {
+            if (!executarInstrucoes()) ThisThread::flags_wait_any(FLAG_COMANDO | FLAG_INSTRUCAO);
+        }
+        bool ok = true;
+        Registro_Gravar(REG_FASE_INICIO, REGISTRO_SEM_EIXO, c.tipo, 0, 0);
+        switch (c.tipo) {
+            case Comando::HOMING:  Pipetadora_Homing();  break;
+            case Comando::MANUAL:  manual();             break;
+            case Comando::PARAR:   Pipetadora_StopAll(); break;
+            case Comando::PIPETAR: ok = pipetar(c);      break;
+        }
+        Registro_Gravar(REG_FASE_FIM, REGISTRO_SEM_EIXO, c.tipo, ok, 0);
+        enviar(Status::FIM, ok);
+    }
+}
+
+void Protocolo_Start(void) {
+    movimento.start(callback(threadMovimento));
+}
+
+bool Protocolo_Send(const Comando& c) {
+    if (!comandos.push(c)) return false;
+    movimento.flags_set(FLAG_COMANDO);
+    return true;
+}
+
+bool Protocolo_Poll(Status& s) {
+    return respostas.pop(s);
+}
+
+bool Protocolo_Instruir(const Instrucao& i) {
+    if (!instrucoes.push(i)) return false;
+    movimento.flags_set(FLAG_INSTRUCAO);
+    return true;
+}
+
+uint32_t Protocolo_Executadas(void) {
+    return executadas;
+}
+
+bool Protocolo_Alarme(void) {
+    return alarme;
+}
+
+void Protocolo_Alarmar(void) {
+    alarme = true;
+}
@@ -0,0 +1,57 @@
+// Protocolo.h
+#ifndef PROTOCOLO_H
+#define PROTOCOLO_H
+
+#include "mbed.h"
+
+#define MAX_POINTS 9 //Definição de pontos maximos para solta
+
+// Posição ensinada (passos X, Y e meios passos Z)
+typedef struct { int32_t pos[3]; } Ponto;
+
+// Comando da thread de interface para a thread de movimento
+struct Comando {
+    enum Tipo : uint8_t { HOMING, MANUAL, PARAR, PIPETAR };
+    Tipo tipo;
+    // PIPETAR: pontos e volumes (não podem mudar até o FIM do comando)
+    const Ponto* coleta;
+    const Ponto* solta;
+    const int*   volume;
+    int          numSolta;
+};
+
+// Resposta da thread de movimento; todo comando termina com um FIM
+struct Status {
+    enum Tipo : uint8_t { PROGRESSO, FIM };
+    Tipo tipo;
+    bool ok;        // FIM: false → emergência, fim de curso ou parada
+    int  ponto;     // PROGRESSO: ponto de solta atual (0..numSolta-1)
+    int  feitos;    // PROGRESSO: ciclos concluídos no ponto
+};
+
+// Instrução do terminal serial: executada em ordem pela thread de movimento,
+// entre os comandos da interface; posições em passos (Z em meios passos)
+struct Instrucao {
+    enum Tipo : uint8_t { LINEAR, Z, DESLOCAR, VALVULA, PAUSA, ESPERAR, HOMING, REARMAR };
+    Tipo    tipo;
+    int32_t alvo[3];   // LINEAR: x,y | Z: z | DESLOCAR: x,y,z | PAUSA: ms
+};
+
+// Cria a thread de movimento (prioridade alta); chamar após Pipetadora_InitMotors
+void Protocolo_Start(void);
+// Interface → movimento; false com a fila cheia
+bool Protocolo_Send(const Comando& c);
+// Movimento → interface, sem bloquear; false sem novidades
+bool Protocolo_Poll(Status& s);
+
+// Terminal → movimento; false com a fila cheia
+bool     Protocolo_Instruir(const Instrucao& i);
+// Instruções retiradas da fila (executadas ou descartadas) desde o boot
+uint32_t Protocolo_Executadas(void);
+// Uma instrução falhou (emergência, fim de curso ou comando da interface no
+// meio): as seguintes são descartadas até um REARMAR
+bool     Protocolo_Alarme(void);
+// Entra em alarme (parada pedida pelo terminal; vale em ISR)
+void     Protocolo_Alarmar(void);
+
+#endif // PROTOCOLO_H
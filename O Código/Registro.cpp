@@ -0,0 +1,93 @@
+#include "Registro.h"
+
+static_assert((REGISTRO_TAM & (REGISTRO_TAM - 1)) == 0, "REGISTRO_TAM deve ser potência de 2");
+static_assert(sizeof(Registro_Evento) == 16, "Registro_Evento deve ter 16 bytes");
+
+static Registro_Evento   eventos[REGISTRO_TAM];
+static volatile uint32_t escrita;   // próximo índice a reservar
+
+// Marca de validade do índice i: muda a cada volta, então um evento
+// sobrescrito (ou ainda sendo escrito) nunca passa pelo do índice pedido
+static inline uint8_t volta(uint32_t i) {
+    return uint8_t(0x80 | ((i / REGISTRO_TAM) & 0x7F));
+}
+
+// Várias fontes (ISRs e threads) reservam o índice com a operação atômica; quem
+// for interrompido no meio da escrita deixa a marca zerada até terminar
+void Registro_Gravar(uint8_t tipo, uint8_t eixo, uint8_t arg, int32_t a, int32_t b) {
+    const uint32_t tempo = us_ticker_read();
+    const uint32_t i = core_util_atomic_incr_u32(&escrita, 1) - 1;
+    volatile Registro_Evento& e = eventos[i & (REGISTRO_TAM - 1)];
+    e.volta = 0;
+    e.tempo = tempo;
+    e.tipo  = tipo;
+    e.eixo  = eixo;
+    e.arg   = arg;
+    e.a     = a;
+    e.b     = b;
+    e.volta = volta(i);
+}
+
+uint32_t Registro_Total(void) {
+    return escrita;
+}
+
+uint32_t Registro_Inicio(void) {
+    uint32_t fim = escrita;
+    return (fim > REGISTRO_TAM) ? fim - REGISTRO_TAM : 0;
+}
+
+int Registro_Ler(uint32_t* cursor, Registro_Evento* dst, int max, uint32_t* perdidas) {
+    uint32_t i = *cursor;
+    uint32_t fim = escrita;
+    uint32_t p = 0;
+    if (fim - i > REGISTRO_TAM && fim > REGISTRO_TAM) {
+        p += fim - REGISTRO_TAM - i;
+        i  = fim - REGISTRO_TAM;
+    }
+    int n = 0;
+    for (; n < max && i != fim; ++i) {
+        const volatile Registro_Evento& e = eventos[i & (REGISTRO_TAM - 1)];
+        // a marca lida antes e depois da cópia confirma que nenhuma escrita a cruzou
+        if (e.volta != volta(i)) { ++p; continue; }
+        Registro_Evento& d = dst[n];
+        d.tempo = e.tempo;
+        d.tipo  = e.tipo;
+        d.eixo  = e.eixo;
+        d.arg   = e.arg;
+        d.a     = e.a;
+        d.b     = e.b;
+        d.volta = e.volta;
+        if (d.volta != volta(i)) { ++p; continue; }
+        ++n;
+    }
+    *cursor = i;
+    if (perdidas) *perdidas += p;
+    return n;
+}
+
+void Registro_Dump(void) {
+    // até o total lido agora: as ISR continuam gravando durante o printf
+    const uint32_t fim = Registro_Total();
+    uint32_t cursor = Registro_Inicio();
+    uint32_t perdidas = 0;
+    printf("#registro %u %lu\n", (unsigned)sizeof(Registro_Evento), (unsigned long)fim);
+    Registro_Evento buf[16];
+    while (int32_t(fim - cursor) > 0) {
+        int n = Registro_Ler(&cursor, buf, (fim - cursor < 16) ? int(fim - cursor) : 16, &perdidas);
+        for (int k = 0; k < n; ++k) {
+            // dois dígitos por byte montados à mão: o minimal-printf não
+            // respeita o '0' de "%02x" e o host lê pares fixos
+            static const char hex[] = "0123456789abcdef";
+            char linha[2 * sizeof(Registro_Evento) + 1];
+            const uint8_t* b = reinterpret_cast<const uint8_t*>(&buf[k]);
+            for (unsigned j = 0; j < sizeof(Registro_Evento); ++j) {
+                linha[2 * j]     = hex[b[j] >> 4];
+                linha[2 * j + 1] = hex[b[j] & 0x0f];
+            }
+            linha[2 * sizeof(Registro_Evento)] = '\0';
+            printf("%s\n", linha);
+        }
+    }
+    if (perdidas) printf("#perdidas %lu\n", (unsigned long)perdidas);
+}
@@ -0,0 +1,74 @@
+// Registro.h
+// Registro de eventos do movimento e do protocolo: buffer circular de tamanho
+// fixo em RAM, sempre ligado, com registros binários de 16 bytes marcados com
+// o us_ticker. Gravar custa uma reserva atômica do índice (LDREX/STREX, sem
+// trava, vale em ISR e em threads) e seis escritas; o buffer guarda os últimos
+// REGISTRO_TAM eventos e é despejado no console depois de uma falha.
+#ifndef REGISTRO_H
+#define REGISTRO_H
+
+#include "mbed.h"
+
+#define REGISTRO_TAM      512         // eventos guardados (potência de 2; 16 bytes cada)
+#define REGISTRO_SEM_EIXO 0xFF
+#define REGISTRO_SEM_ALVO INT32_MIN   // alvo do jog
+
+// Tipos de evento; a e b dependem do tipo
+typedef enum {
+    REG_MOV_INICIO  = 1,   // eixo; arg: REG_JOG/REG_ESCRAVO; a = posição, b = alvo
+    REG_MOV_FIM     = 2,   // eixo; arg: Registro_Motivo; a = posição alcançada, b = alvo
+    REG_FIM_CURSO   = 3,   // eixo; arg = sentido (0 frente, 1 trás); a = posição
+    REG_VALVULA     = 4,   // arg = nível do pino (0 → acionada)
+    REG_EMERGENCIA  = 5,   // arg = 1 apertada, 0 solta
+    REG_FASE_INICIO = 6,   // arg: Registro_Fase; a, b conforme a fase
+    REG_FASE_FIM    = 7    // arg: Registro_Fase; a = 1 ok, 0 falha
+} Registro_Tipo;
+
+// REG_MOV_INICIO: bits de arg
+#define REG_JOG     0x01   // sem alvo, até fim de curso ou parada
+#define REG_ESCRAVO 0x02   // segue o outro eixo na interpolação X/Y
+
+// REG_MOV_FIM: por que o eixo parou
+typedef enum {
+    REG_ALVO   = 0,   // chegou ao alvo
+    REG_CURSO  = 1,   // fim de curso
+    REG_PARADA = 2    // stop/stopAll, desaceleração do jog ou novo movimento
+} Registro_Motivo;
+
+// Fases: os comandos da thread de movimento (mesma ordem de Comando::Tipo)
+// e o ciclo aspirar/dispensar (a = ponto, b = ciclo no ponto)
+typedef enum {
+    REG_HOMING  = 0,
+    REG_MANUAL  = 1,
+    REG_PARAR   = 2,
+    REG_PIPETAR = 3,
+    REG_CICLO   = 4
+} Registro_Fase;
+
+// Formato binário (little-endian, como na RAM e no despejo)
+typedef struct {
+    uint32_t tempo;   // us_ticker_read() (32 bits, volta a cada ~71 min)
+    uint8_t  tipo;    // Registro_Tipo
+    uint8_t  eixo;    // 0=X, 1=Y, 2=Z ou REGISTRO_SEM_EIXO
+    uint8_t  arg;
+    uint8_t  volta;   // validade: 0x80 | volta do buffer; 0 durante a escrita
+    int32_t  a;
+    int32_t  b;
+} Registro_Evento;
+
+// Grava um evento (ISR ou thread)
+void Registro_Gravar(uint8_t tipo, uint8_t eixo, uint8_t arg, int32_t a, int32_t b);
+// Índice do evento mais antigo ainda no buffer
+uint32_t Registro_Inicio(void);
+// Total de eventos gravados desde o boot
+uint32_t Registro_Total(void);
+// Copia até max eventos a partir do índice *cursor e o avança; perdidas soma
+// os sobrescritos antes ou durante a cópia. Não consome: pode ser relido.
+int Registro_Ler(uint32_t* cursor, Registro_Evento* dst, int max, uint32_t* perdidas);
+// Despejo no console, lido por simulador registro <arquivo>:
+//   #registro tamanho_do_evento total
+//   um evento por linha, os 16 bytes em hexadecimal
+//   #perdidas n
+void Registro_Dump(void);
+
+#endif // REGISTRO_H
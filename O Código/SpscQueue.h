@@ -0,0 +1,45 @@
+// SpscQueue.h
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include "mbed.h"
+
+// Fila circular sem trava para um único produtor e um único consumidor
+// (threads diferentes ou thread/ISR). Cada índice é escrito por um só lado;
+// as operações de mbed_atomic publicam o índice depois do item gravado.
+// N deve ser potência de 2.
+template <typename T, uint32_t N>
+class SpscQueue {
+    static_assert((N & (N - 1)) == 0, "SpscQueue: N deve ser potencia de 2");
+public:
+    SpscQueue() : _cabeca(0), _cauda(0) {}
+
+    // Produtor: false com a fila cheia
+    bool push(const T& item) {
+        uint32_t cauda = _cauda;
+        if (cauda - core_util_atomic_load_u32(&_cabeca) >= N) return false;
+        _item[cauda % N] = item;
+        core_util_atomic_store_u32(&_cauda, cauda + 1);
+        return true;
+    }
+
+    // Consumidor: false com a fila vazia
+    bool pop(T& item) {
+        uint32_t cabeca = _cabeca;
+        if (core_util_atomic_load_u32(&_cauda) == cabeca) return false;
+        item = _item[cabeca % N];
+        core_util_atomic_store_u32(&_cabeca, cabeca + 1);
+        return true;
+    }
+
+    bool empty() const {
+        return core_util_atomic_load_u32(&_cauda) == core_util_atomic_load_u32(&_cabeca);
+    }
+
+private:
+    T                 _item[N];
+    volatile uint32_t _cabeca;   // escrito só pelo consumidor
+    volatile uint32_t _cauda;    // escrito só pelo produtor
+};
+
+#endif // SPSCQUEUE_H
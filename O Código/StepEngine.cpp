@@ -0,0 +1,679 @@
+#include "StepEngine.h"
+#include "Planner.h"
+#include "Perfil.h"
+#include "Registro.h"
+
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+// Trechos Z da fila vão para o último eixo
+static constexpr int EIXO_Z = STEP_EIXOS - 1;
+
+// Tempo de CPU de cada evento do timer (tela Perfil CPU)
+PERFIL_DEFINIR(perfPassos, "passos");
+
+StepEngine::StepEngine()
+    : _versao(0), _agendado(false), _planner(nullptr), _valvula(nullptr),
+      _emFila(false), _falha(false), _esperando(false), _zSeguro(INT32_MAX) {}
+
+void StepEngine::attachDriver(int id, DigitalOut* step, DigitalOut* dir, DigitalOut* enable,
+                              DigitalIn* endMin, DigitalIn* endMax) {
+    Canal& c = _canal[id];
+    c.step   = step;
+    c.dir    = dir;
+    c.enable = enable;
+    c.endMin = endMin;
+    c.endMax = endMax;
+}
+
+void StepEngine::attachCoils(int id, BusOut* coils, const uint8_t* seq, int seqLen, int passo,
+                             DigitalIn* endMin, DigitalIn* endMax) {
+    Canal& c = _canal[id];
+    c.coils  = coils;
+    c.seq    = seq;
+    c.seqLen = seqLen;
+    c.passo  = passo;
+    c.endMin = endMin;
+    c.endMax = endMax;
+}
+
+void StepEngine::setCoilSequence(int id, const uint8_t* seq, int seqLen, int passo) {
+    CriticalSectionLock lock;
+    Canal& c = _canal[id];
+    if (c.ativo) finish(id);
+    // mesma posição angular na nova sequência (meio passo ↔ passo cheio)
+    c.seqIdx = (c.seqIdx * c.passo / passo) % seqLen;
+    c.seq    = seq;
+    c.seqLen = seqLen;
+    c.passo  = passo;
+}
+
+int StepEngine::buildRamp(uint16_t* tab, int tamMax, microseconds inicial,
+                          microseconds minimo, float aceleracao) {
+    // velocidade após n eventos: v(n) = sqrt(v0² + 2·a·n); o período do evento n
+    // é o tempo entre as posições n e n+1 dessa curva
+    const float v0  = 1e6f / inicial.count();
+    const float v02 = v0 * v0;
+    float t0 = 0.0f;
+    int n = 0;
+    while (n < tamMax) {
+        float t1 = (sqrtf(v02 + 2.0f * aceleracao * (n + 1)) - v0) / aceleracao;
+        float p  = (t1 - t0) * 1e6f;
+        t0 = t1;
+        if (p > inicial.count()) p = inicial.count();
+        tab[n++] = uint16_t(p + 0.5f);
+        if (p <= minimo.count()) break;
+    }
+    return n;
+}
+
+// Distância (eventos) da subida em S do repouso até vp; devolve a duração dos
+// trechos de jerk (t1) e de aceleração constante (t2)
+static float sCurveDistance(float vp, float amax, float jmax, float& t1, float& t2) {
+    if (vp * jmax < amax * amax) {
+        // aceleração de pico não chega a amax
+        t1 = sqrtf(vp / jmax);
+        t2 = 0.0f;
+    } else {
+        t1 = amax / jmax;
+        t2 = vp / amax - t1;
+    }
+    // a curva de velocidade é simétrica em torno do ponto médio da subida
+    return 0.5f * vp * (2.0f * t1 + t2);
+}
+
+int StepEngine::buildSCurve(uint16_t* tab, int tamMax, uint32_t eventos,
+                            float vmax, float amax, float jmax) {
+    float t1, t2;
+    float vp = vmax;
+    float d  = sCurveDistance(vp, amax, jmax, t1, t2);
+    if (2.0f * d > eventos || d > tamMax) {
+        // busca binária da maior velocidade de pico que cabe no percurso
+        float lo = 0.0f, hi = vmax;
+        for (int k = 0; k < 24; ++k) {
+            float mid = 0.5f * (lo + hi);
+            d = sCurveDistance(mid, amax, jmax, t1, t2);
+            if (2.0f * d <= eventos && d <= tamMax) lo = mid;
+            else                                    hi = mid;
+        }
+        vp = lo;
+        d  = sCurveDistance(vp, amax, jmax, t1, t2);
+    }
+    int n = int(d);
+    if (n > tamMax) n = tamMax;
+    if (n < 1 || vp <= 0.0f) return 0;
+
+    const float a  = jmax * t1;                  // aceleração de pico
+    const float v1 = 0.5f * jmax * t1 * t1;      // velocidade ao fim do 1º trecho
+    const float p1 = jmax * t1 * t1 * t1 / 6.0f; // posição ao fim do 1º trecho
+    const float T  = 2.0f * t1 + t2;
+    auto vel = [&](float t) {
+        if (t < t1)      return 0.5f * jmax * t * t;
+        if (t < t1 + t2) return v1 + a * (t - t1);
+        if (t < T)       return vp - 0.5f * jmax * (T - t) * (T - t);
+        return vp;
+    };
+
+    float tAnt = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        float t;
+        float pos = float(i + 1);
+        if (pos <= p1) {
+            // trecho de jerk constante: p = J·t³/6
+            t = cbrtf(6.0f * pos / jmax);
+        } else {
+            // demais trechos: passo pelo ponto médio da velocidade
+            float v = vel(tAnt);
+            float dt = 1.0f / v;
+            v  = vel(tAnt + 0.5f * dt);
+            t  = tAnt + 1.0f / v;
+        }
+        float p = (t - tAnt) * 1e6f;
+        tab[i] = (p > 65535.0f) ? 65535 : uint16_t(p + 0.5f);
+        tAnt = t;
+    }
+    return n;
+}
+
+void StepEngine::setRamp(int id, const uint16_t* tab, int len, microseconds minimo) {
+    CriticalSectionLock lock;
+    Canal& c = _canal[id];
+    c.rampa    = tab;
+    c.rampaLen = len;
+    c.minimo   = minimo;
+    setLimitIndex(c);
+}
+
+void StepEngine::setMinPeriod(int id, microseconds minimo) {
+    CriticalSectionLock lock;
+    Canal& c = _canal[id];
+    if (c.minimo == minimo) return;
+    c.minimo = minimo;
+    setLimitIndex(c);
+    if (c.ativo && c.tab == c.rampa) {
+        c.tabMax = c.idxMax;
+        c.piso   = c.minimo;
+    }
+}
+
+int StepEngine::rampIndex(const uint16_t* tab, int len, microseconds minimo) {
+    if (!tab || len <= 0) return 0;
+    int lo = 0, hi = len - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (microseconds(tab[mid]) <= minimo) hi = mid;
+        else                                  lo = mid + 1;
+    }
+    return lo;
+}
+
+void StepEngine::setLimitIndex(Canal& c) {
+    c.idxMax = rampIndex(c.rampa, c.rampaLen, c.minimo);
+}
+
+void StepEngine::setPosition(int id, int32_t pos) {
+    CriticalSectionLock lock;
+    _canal[id].posicao = pos;
+    _versao = _versao + 1;
+}
+
+//Retrato sem trava: a ISR não é interrompida pela thread que lê, então basta
+//repetir a cópia quando _versao mudou no meio dela
+void StepEngine::snapshot(Retrato& r) const {
+    uint32_t v;
+    do {
+        v = _versao;
+        r.movendo = 0;
+        for (int i = 0; i < STEP_EIXOS; ++i) {
+            r.posicao[i] = _canal[i].posicao;
+            if (_canal[i].ativo) r.movendo |= uint8_t(1u << i);
+        }
+        r.emFila = _emFila;
+    } while (v != _versao);
+}
+
+//Prepara o eixo parado para um novo movimento no sentido dir
+void StepEngine::prepare(int id, int dir) {
+    Canal& c = _canal[id];
+    c.sentido    = dir;
+    c.limite     = false;
+    c.mestre     = -1;
+    c.indice     = -1;
+    c.saida      = 0;
+    c.tab        = c.rampa;
+    c.tabMax     = c.idxMax;
+    c.piso       = c.minimo;
+    if (c.step) {
+        // borda de descida não gera passo: todo movimento começa com STEP baixo
+        c.step->write(0);
+        c.nivel = false;
+        c.dir->write(dir);
+        c.enable->write(0);
+    }
+}
+
+//Troca a rampa do eixo pela curva S só neste movimento
+void StepEngine::useCurve(Canal& c, const uint16_t* curva, int len) {
+    if (!curva || len <= 0) return;
+    c.tab    = curva;
+    c.tabMax = len - 1;
+    c.piso   = 0us;
+}
+
+//Agenda o primeiro evento do eixo a partir de base (o chamador arma o timer)
+void StepEngine::start(int id, TickerDataClock::time_point base) {
+    Canal& c = _canal[id];
+    c.prox  = base + nextPeriod(c);
+    c.ativo = true;
+}
+
+//Arma o timer em t; só mexe no timer se o prazo for o mais próximo
+void StepEngine::arm(TickerDataClock::time_point t) {
+    if (!_agendado || t < _prazo) {
+        if (_agendado) remove();
+        _agendado = true;
+        _prazo    = t;
+        insert_absolute(_prazo);
+    }
+}
+
+//Arma o timer para o menor prazo pendente (eixos e espera da fila)
+void StepEngine::reschedule() {
+    TickerDataClock::time_point proximo = TickerDataClock::time_point::max();
+    for (int id = 0; id < STEP_EIXOS; ++id) {
+        const Canal& c = _canal[id];
+        if (c.ativo && c.mestre < 0 && c.prox < proximo) proximo = c.prox;
+    }
+    if (_esperando && _fimEspera < proximo) proximo = _fimEspera;
+    if (proximo != TickerDataClock::time_point::max()) arm(proximo);
+}
+
+//Desliga o driver, exceto enquanto a fila segue (o próximo trecho já vem)
+void StepEngine::release(Canal& c) {
+    if (c.step && !_emFila) c.enable->write(1);
+}
+
+void StepEngine::attachDone(mbed::Callback<void(int, bool)> aviso) {
+    _aviso = aviso;
+}
+
+void StepEngine::notify(int id, bool falha) {
+    if (_aviso) _aviso(id, falha);
+}
+
+//Encerra o eixo e os escravos ligados a ele
+void StepEngine::finish(int id) {
+    Canal& c = _canal[id];
+    c.ativo = false;
+    if (c.limite) Registro_Gravar(REG_FIM_CURSO, id, c.sentido, c.posicao, 0);
+    Registro_Gravar(REG_MOV_FIM, id, c.limite ? REG_CURSO : (c.posicao == c.alvo) ? REG_ALVO : REG_PARADA,
+                    c.posicao, c.alvo);
+    // o jog termina no fim de curso por definição; o topo do Z re-referencia
+    notify(id, c.limite && !c.continuo && !(c.zeraMax && c.sentido == 0));
+    if (c.step) {
+        c.step->write(0);
+        c.nivel = false;
+        release(c);
+    }
+    if (c.coils) *c.coils = 0;
+    for (int s = 0; s < STEP_EIXOS; ++s) {
+        if (_canal[s].mestre == id) {
+            _canal[s].mestre = -1;
+            finish(s);
+        }
+    }
+}
+
+void StepEngine::jog(int id, int dir) {
+    CriticalSectionLock lock;
+    Canal& c = _canal[id];
+    if (c.ativo && c.mestre < 0 && c.sentido == dir) {
+        // ainda girando no mesmo sentido (ex.: desacelerando): retoma o jog
+        c.continuo = true;
+        return;
+    }
+    if (c.ativo) finish(id);
+    prepare(id, dir);
+    c.continuo = true;
+    c.alvo     = REGISTRO_SEM_ALVO;
+    Registro_Gravar(REG_MOV_INICIO, id, REG_JOG, c.posicao, c.alvo);
+    if (atLimit(c)) { c.limite = true; finish(id); return; }
+    start(id, _ticker_data.now());
+    arm(c.prox);
+}
+
+void StepEngine::moveTo(int id, int32_t target, const uint16_t* curva, int len) {
+    CriticalSectionLock lock;
+    if (!setupMove(id, target)) return;
+    useCurve(_canal[id], curva, len);
+    start(id, _ticker_data.now());
+    arm(_canal[id].prox);
+}
+
+void StepEngine::moveLinear(int32_t tx, int32_t ty, const uint16_t* curva, int len) {
+    CriticalSectionLock lock;
+    int m = setupLinear(tx, ty);
+    if (m < 0) return;
+    useCurve(_canal[m], curva, len);
+    start(m, _ticker_data.now());
+    arm(_canal[m].prox);
+}
+
+//Prepara o eixo para ir até target; false se já está lá ou no fim de curso
+bool StepEngine::setupMove(int id, int32_t target) {
+    Canal& c = _canal[id];
+    if (c.ativo) finish(id);
+    int32_t delta = target - c.posicao;
+    if (delta == 0) {
+        // já no alvo: o fim de curso do movimento anterior (ex.: homing) não é falha deste
+        c.limite = false;
+        return false;
+    }
+    prepare(id, delta > 0 ? 0 : 1);
+    c.continuo = false;
+    c.alvo     = target;
+    Registro_Gravar(REG_MOV_INICIO, id, 0, c.posicao, target);
+    if (atLimit(c)) { c.limite = true; finish(id); return false; }
+    uint32_t dist = abs(delta);
+    // driver: posição conta 2 por passo (subida + descida); bobinas: passo por entrada
+    c.restantes = c.step ? ((dist + 1) & ~1u) : (dist + c.passo - 1) / c.passo;
+    return true;
+}
+
+//Prepara a interpolação X/Y até (tx,ty); retorna o eixo mestre (-1 → nada a mover)
+int StepEngine::setupLinear(int32_t tx, int32_t ty) {
+    const int32_t alvo[2] = { tx, ty };
+    int32_t passos[2];
+    for (int i = 0; i < 2; ++i) {
+        if (_canal[i].ativo) finish(i);
+        int32_t delta = alvo[i] - _canal[i].posicao;
+        prepare(i, delta >= 0 ? 0 : 1);
+        passos[i] = (abs(delta) + 1) / 2;
+    }
+    int m = (passos[0] >= passos[1]) ? 0 : 1;
+    int s = 1 - m;
+    if (passos[m] == 0) {
+        release(_canal[0]);
+        release(_canal[1]);
+        return -1;
+    }
+    Canal& cm = _canal[m];
+    cm.restantes = 2 * passos[m];
+    cm.continuo  = false;
+    cm.alvo      = alvo[m];
+    Registro_Gravar(REG_MOV_INICIO, m, 0, cm.posicao, alvo[m]);
+
+    Canal& cs = _canal[s];
+    if (passos[s] > 0) {
+        cs.mestre   = m;
+        cs.dEscravo = passos[s];
+        cs.dMestre  = passos[m];
+        cs.erro     = passos[m] / 2;
+        cs.continuo = false;
+        cs.alvo     = alvo[s];
+        cs.ativo    = true;
+        Registro_Gravar(REG_MOV_INICIO, s, REG_ESCRAVO, cs.posicao, alvo[s]);
+    } else {
+        release(cs);
+    }
+    return m;
+}
+
+void StepEngine::decelerate(int id) {
+    CriticalSectionLock lock;
+    Canal& c = _canal[id];
+    if (!c.ativo || c.mestre >= 0) return;
+    if (!c.tab || c.indice < 0) { finish(id); return; }
+    // eventos necessários para descer a rampa até a entrada 0
+    uint32_t n = c.indice + 1;
+    // driver: o último evento precisa ser uma descida do STEP
+    if (c.step && ((n & 1u) != (c.nivel ? 1u : 0u))) ++n;
+    if (c.continuo || n < c.restantes) c.restantes = n;
+    c.continuo = false;
+}
+
+void StepEngine::stop(int id) {
+    CriticalSectionLock lock;
+    if (_canal[id].ativo) finish(id);
+}
+
+void StepEngine::stopAll() {
+    CriticalSectionLock lock;
+    if (_emFila || _esperando) {
+        _falha     = true;
+        _emFila    = false;
+        _esperando = false;
+        notify(STEP_FILA, true);
+    }
+    for (int i = 0; i < STEP_EIXOS; ++i) {
+        if (_canal[i].ativo) finish(i);
+        if (_canal[i].coils) *_canal[i].coils = 0;
+    }
+}
+
+bool StepEngine::atLimit(const Canal& c) const {
+    DigitalIn* fim = (c.sentido == 0) ? c.endMax : c.endMin;
+    return fim && fim->read();
+}
+
+//Período até o próximo evento: perfil trapezoidal sobre a tabela de aceleração.
+//O índice anda no máximo uma entrada por evento e nunca passa de saida+restantes-1,
+//de modo que a descida espelha a subida e termina na entrada saida sobre o alvo.
+microseconds StepEngine::nextPeriod(Canal& c) {
+    if (!c.tab) return c.minimo;
+    int alvo = c.tabMax;
+    if (!c.continuo && c.saida + int32_t(c.restantes) - 1 < alvo) alvo = c.saida + int32_t(c.restantes) - 1;
+    if      (alvo > c.indice) ++c.indice;
+    else if (alvo < c.indice && c.indice > 0) --c.indice;
+    microseconds p(c.tab[c.indice]);
+    return (p < c.piso) ? c.piso : p;
+}
+
+//Gera um evento (borda de STEP ou passo de bobina) no eixo id e nos seus escravos
+void StepEngine::event(int id) {
+    Canal& c = _canal[id];
+    if (atLimit(c)) {
+        c.limite = true;
+        if (c.zeraMax && c.sentido == 0) c.posicao = 0;
+        finish(id);
+        return;
+    }
+    const int32_t inc = (c.sentido == 0) ? 1 : -1;
+    bool subida = false;
+    if (c.coils) {
+        c.seqIdx  = (c.seqIdx + (c.sentido == 0 ? 1 : c.seqLen - 1)) % c.seqLen;
+        *c.coils  = c.seq[c.seqIdx];
+        c.posicao += inc * c.passo;
+    } else {
+        subida  = !c.nivel;
+        c.nivel = subida;
+        c.step->write(subida);
+        if (subida) c.posicao += 2 * inc;
+    }
+#if STEP_TRACE
+    mark(id, subida || c.coils, c.prox);
+#endif
+
+    for (int s = 0; s < STEP_EIXOS; ++s) {
+        Canal& e = _canal[s];
+        if (e.mestre != id) continue;
+        if (!subida) {
+            if (e.nivel) { e.step->write(0); e.nivel = false; }
+            continue;
+        }
+        e.erro += e.dEscravo;
+        if (e.erro >= e.dMestre) {
+            e.erro -= e.dMestre;
+            if (atLimit(e)) {
+                e.limite = true;
+                e.mestre = -1;
+                finish(s);
+                continue;
+            }
+            e.step->write(1);
+            e.nivel = true;
+            e.posicao += (e.sentido == 0) ? 2 : -2;
+#if STEP_TRACE
+            mark(s, true, c.prox);
+#endif
+        }
+    }
+
+    if (!c.continuo && --c.restantes == 0) finish(id);
+}
+
+#if STEP_TRACE
+static_assert((STEP_TRACE_TAM & (STEP_TRACE_TAM - 1)) == 0, "STEP_TRACE_TAM deve ser potência de 2");
+
+//Grava a borda logo após a escrita no pino; prazo é o instante planejado
+//(para o escravo, o do mestre)
+void StepEngine::mark(int id, bool passo, TickerDataClock::time_point prazo) {
+    Marca& m = _marcas[_traceEscrita & (STEP_TRACE_TAM - 1)];
+    m.ciclos = DWT->CYCCNT;
+    m.prazo  = uint32_t(prazo.time_since_epoch().count());
+    m.eixo   = uint8_t(id);
+    m.passo  = passo;
+    _traceEscrita = _traceEscrita + 1;
+}
+
+void StepEngine::traceStart(uint32_t& ciclos, uint32_t& us) {
+    CriticalSectionLock lock;
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    _traceLeitura = _traceEscrita;
+    ciclos = DWT->CYCCNT;
+    us     = uint32_t(_ticker_data.now().time_since_epoch().count());
+}
+
+int StepEngine::traceRead(Marca* dst, int max, uint32_t& perdidas) {
+    uint32_t fim = _traceEscrita;
+    if (fim - _traceLeitura > STEP_TRACE_TAM) {
+        perdidas += fim - _traceLeitura - STEP_TRACE_TAM;
+        _traceLeitura = fim - STEP_TRACE_TAM;
+    }
+    const uint32_t inicio = _traceLeitura;
+    int n = 0;
+    while (n < max && _traceLeitura != fim) {
+        dst[n++] = _marcas[_traceLeitura & (STEP_TRACE_TAM - 1)];
+        ++_traceLeitura;
+    }
+    // a ISR pode ter reescrito o começo do trecho durante a cópia: a borda i só
+    // continua intacta se i >= escrita - TAM
+    int32_t ruins = int32_t(_traceEscrita - STEP_TRACE_TAM - inicio);
+    if (ruins > 0) {
+        if (ruins > n) ruins = n;
+        perdidas += ruins;
+        memmove(dst, dst + ruins, (n - ruins) * sizeof(Marca));
+        n -= ruins;
+    }
+    return n;
+}
+#endif
+
+void StepEngine::setHomeOnLimit(int id, bool ativo) {
+    _canal[id].zeraMax = ativo;
+}
+
+void StepEngine::attachPlanner(Planner* planner, DigitalOut* valvula) {
+    _planner = planner;
+    _valvula = valvula;
+}
+
+void StepEngine::setSafeHeight(int32_t z) {
+    CriticalSectionLock lock;
+    _zSeguro = z;
+}
+
+void StepEngine::runQueue() {
+    CriticalSectionLock lock;
+    if (!_planner || _emFila) return;
+    _emFila  = true;
+    _falha   = false;
+    feed(_ticker_data.now());
+    reschedule();
+}
+
+//Fim de curso no meio da fila: para tudo e deixa a thread limpar a fila
+void StepEngine::abortQueue() {
+    _emFila    = false;
+    _esperando = false;
+    _falha     = true;
+    for (int i = 0; i < STEP_EIXOS; ++i) {
+        if (_canal[i].ativo) finish(i);
+        release(_canal[i]);
+    }
+    notify(STEP_FILA, true);
+}
+
+//O trecho s pode partir com os eixos no estado atual? Por padrão espera tudo
+//parar; trechos com sobrepor usam as regras da altura segura do Z
+bool StepEngine::canStart(const Segmento& s) const {
+    if (_esperando) return false;
+    const bool   xy = _canal[0].ativo || _canal[1].ativo;
+    const Canal& z  = _canal[EIXO_Z];
+    switch (s.tipo) {
+    case Segmento::XY:
+        if (xy) return false;
+        // Z subindo: o XY parte assim que a ponteira passa da altura segura
+        return !z.ativo || (s.sobrepor && z.sentido == 0 && z.posicao >= _zSeguro);
+    case Segmento::Z: {
+        if (z.ativo) return false;
+        if (!xy) return true;
+        if (!s.sobrepor) return false;
+        // Z descendo: parte na desaceleração final do XY (retido em held())
+        const Canal& m = (_canal[0].ativo && _canal[0].mestre < 0) ? _canal[0] : _canal[1];
+        return m.tab && m.indice >= m.saida &&
+               m.restantes <= uint32_t(m.indice - m.saida + 1);
+    }
+    default:
+        return !xy && !z.ativo;
+    }
+}
+
+//Z descendo não passa da altura segura enquanto o XY anda
+bool StepEngine::held(int id) const {
+    const Canal& c = _canal[id];
+    return _emFila && id == EIXO_Z && c.sentido == 1 && c.posicao - c.passo < _zSeguro &&
+           (_canal[0].ativo || _canal[1].ativo);
+}
+
+//Inicia, a partir do instante t, os trechos da fila cujas condições de partida
+//já valem; encerra a fila quando ela esvazia com tudo parado
+void StepEngine::feed(TickerDataClock::time_point t) {
+    while (Segmento* s = _planner->peek()) {
+        if (!canStart(*s)) return;
+        // o espaço do trecho retirado só é reaproveitado depois do próximo
+        _planner->pop();
+        switch (s->tipo) {
+        case Segmento::PINO:
+            if (_valvula) _valvula->write(s->alvo[0]);
+            Registro_Gravar(REG_VALVULA, REGISTRO_SEM_EIXO, s->alvo[0], 0, 0);
+            break;
+        case Segmento::ESPERA:
+            _esperando = true;
+            _fimEspera = t + microseconds(s->alvo[0]);
+            break;
+        case Segmento::Z:
+            if (setupMove(EIXO_Z, s->alvo[0])) start(EIXO_Z, t);
+            else if (_canal[EIXO_Z].limite) { abortQueue(); return; }
+            break;
+        case Segmento::XY: {
+            int m = setupLinear(s->alvo[0], s->alvo[1]);
+            if (m < 0) break;
+            Canal& c = _canal[m];
+            if (s->tab) {
+                c.tab    = s->tab;
+                c.tabMax = s->tabMax;
+                c.piso   = 0us;
+                c.indice = int(s->entrada) - 1;
+                c.saida  = s->saida;
+            }
+            start(m, t);
+            break;
+        }
+        }
+    }
+    if (_esperando) return;
+    for (int i = 0; i < STEP_EIXOS; ++i) {
+        if (_canal[i].ativo) return;
+    }
+    // fila vazia e eixos parados: libera os drivers
+    _emFila = false;
+    for (int i = 0; i < STEP_EIXOS; ++i) release(_canal[i]);
+    notify(STEP_FILA, false);
+}
+
+//Handler único do timer: atende os eixos vencidos, encadeia os trechos da fila
+//e arma o próximo prazo
+void StepEngine::handler() {
+    PERFIL_MEDIR(perfPassos);
+    const TickerDataClock::time_point agora = _ticker_data.now();
+    _agendado = false;
+    _versao = _versao + 1;   // invalida retratos em andamento
+    for (int id = 0; id < STEP_EIXOS; ++id) {
+        Canal& c = _canal[id];
+        if (!c.ativo || c.mestre >= 0 || c.prox > agora) continue;
+        const TickerDataClock::time_point t = c.prox;
+        if (held(id)) {
+            // parado na altura segura: volta a partir do início da rampa
+            c.indice = -1;
+            c.prox  += nextPeriod(c);
+            continue;
+        }
+        event(id);
+        if (c.ativo) c.prox += nextPeriod(c);
+        if (!_emFila) continue;
+        if (!c.ativo) {
+            bool falhou = (id == EIXO_Z) ? (c.limite && !(c.zeraMax && c.sentido == 0))
+                                         : (_canal[0].limite || _canal[1].limite);
+            if (falhou) { abortQueue(); continue; }
+        }
+        // cada evento pode liberar o próximo trecho, que parte deste instante
+        feed(t);
+    }
+    if (_esperando && _fimEspera <= agora) {
+        _esperando = false;
+        if (_emFila) feed(_fimEspera);
+    }
+    reschedule();
+}
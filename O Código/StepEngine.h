@@ -0,0 +1,220 @@
+// StepEngine.h
+#ifndef STEPENGINE_H
+#define STEPENGINE_H
+
+#include "mbed.h"
+
+class Planner;
+struct Segmento;
+
+// Número de eixos tratados pelo gerador de passos (0=X, 1=Y, 2=Z)
+#define STEP_EIXOS 3
+// Id usado no aviso de fim da fila do planejador
+#define STEP_FILA  STEP_EIXOS
+
+// Captura de bordas (instrumentação): cada evento do gerador é gravado num
+// buffer circular em RAM com o DWT->CYCCNT do instante e o prazo planejado
+#ifndef STEP_TRACE
+#define STEP_TRACE     0
+#endif
+#define STEP_TRACE_TAM 1024   // bordas guardadas (potência de 2; 12 bytes cada)
+
+// Gerador de passos multi-eixo com um único evento de timer.
+// Cada eixo guarda o instante absoluto do seu próximo passo; o handler
+// dispara todos os eixos vencidos e reagenda o timer para o menor prazo
+// pendente. Não há detach/attach no caminho crítico.
+class StepEngine : public TimerEvent {
+public:
+    StepEngine();
+
+    // Liga o eixo a um driver STEP/DIR/EN (X e Y)
+    void attachDriver(int id, DigitalOut* step, DigitalOut* dir, DigitalOut* enable,
+                      DigitalIn* endMin, DigitalIn* endMax);
+    // Liga o eixo a bobinas acionadas diretamente pela sequência seq (Z); cada
+    // entrada da sequência anda 'passo' unidades de posição (2 → passo cheio,
+    // 1 → meio passo), como a borda dos drivers
+    void attachCoils(int id, BusOut* coils, const uint8_t* seq, int seqLen, int passo,
+                     DigitalIn* endMin, DigitalIn* endMax);
+    // Troca a sequência das bobinas com o eixo parado, mantendo a fase atual
+    void setCoilSequence(int id, const uint8_t* seq, int seqLen, int passo);
+
+    // Preenche tab com os períodos (us) de cada evento partindo do repouso sob
+    // aceleração constante (eventos/s²), até atingir minimo ou tamMax entradas.
+    // Retorna o número de entradas geradas.
+    static int buildRamp(uint16_t* tab, int tamMax, std::chrono::microseconds inicial,
+                         std::chrono::microseconds minimo, float aceleracao);
+    // Preenche tab com a fase de aceleração de um perfil S (jerk limitado) para um
+    // movimento de 'eventos' eventos: a velocidade de pico é reduzida até que subida
+    // e descida caibam no percurso e na tabela. Limites em eventos/s, /s² e /s³.
+    // Retorna o número de entradas (0 → movimento curto demais para o perfil).
+    static int buildSCurve(uint16_t* tab, int tamMax, uint32_t eventos,
+                           float vmax, float amax, float jmax);
+    // Primeira entrada de tab que já alcança o período mínimo (busca binária)
+    static int rampIndex(const uint16_t* tab, int len, std::chrono::microseconds minimo);
+
+    // Tabela de aceleração do eixo (nullptr → período constante igual ao mínimo)
+    void setRamp(int id, const uint16_t* tab, int len, std::chrono::microseconds minimo);
+    // Altera só o período mínimo (seletor de velocidade); vale também para jog em curso
+    void setMinPeriod(int id, std::chrono::microseconds minimo);
+
+    // Movimento contínuo (0 → frente, 1 → trás) até fim de curso ou stop()
+    void jog(int id, int dir);
+    // Movimento até a posição absoluta target, desacelerando até parar no alvo.
+    // curva/len opcionais substituem a rampa do eixo só neste movimento.
+    void moveTo(int id, int32_t target, const uint16_t* curva = nullptr, int len = 0);
+    // Movimento interpolado X/Y até (tx,ty); o eixo dominante segue a própria rampa
+    // (ou curva/len, se informados)
+    void moveLinear(int32_t tx, int32_t ty, const uint16_t* curva = nullptr, int len = 0);
+    // Aviso de fim de movimento: id do eixo que parou (ou STEP_FILA) e se parou
+    // por falha (fim de curso fora do jog, stopAll). Chamado em contexto de ISR.
+    void attachDone(mbed::Callback<void(int, bool)> aviso);
+
+    // Fila de trechos do planejador; valvula é a saída dos trechos PINO
+    void attachPlanner(Planner* planner, DigitalOut* valvula);
+    // Altura Z (posição) a partir da qual a ponteira está livre durante o XY:
+    // trechos com sobrepor usam-na para sobrepor a subida/descida do Z ao XY
+    void setSafeHeight(int32_t z);
+    // Passa a executar os trechos já planejados: a ISR encadeia um trecho no
+    // seguinte, sem voltar à thread, até a fila esvaziar
+    void runQueue();
+    bool queueBusy() const  { return _emFila; }
+    // A fila parou por fim de curso ou stopAll()
+    bool queueFault() const { return _falha; }
+    // Fim de curso no sentido frente re-referencia o eixo (posição 0) e conta
+    // como chegada, em vez de falha (Z sobe até o topo)
+    void setHomeOnLimit(int id, bool ativo);
+
+    // Desacelera pela rampa até parar (fim do jog manual)
+    void decelerate(int id);
+    // Parada imediata, sem rampa (emergência, troca de sentido)
+    void stop(int id);
+    void stopAll();
+
+    // Retrato dos eixos para a interface
+    struct Retrato {
+        int32_t posicao[STEP_EIXOS];
+        uint8_t movendo;     // um bit por eixo ativo (1<<id)
+        bool    emFila;
+    };
+    // Cópia consistente do estado sem travar a ISR (qualquer thread)
+    void snapshot(Retrato& r) const;
+
+    bool    running(int id) const    { return _canal[id].ativo; }
+    bool    jogging(int id) const    { return _canal[id].ativo && _canal[id].continuo; }
+    bool    hitLimit(int id) const   { return _canal[id].limite; }
+    int     direction(int id) const  { return _canal[id].sentido; }
+    int32_t position(int id) const   { return _canal[id].posicao; }
+    void    setPosition(int id, int32_t pos);
+
+#if STEP_TRACE
+    struct Marca {
+        uint32_t ciclos;   // DWT->CYCCNT na borda
+        uint32_t prazo;    // instante planejado da borda (us do ticker, 32 bits)
+        uint8_t  eixo;
+        uint8_t  passo;    // 1 → a borda andou o eixo (subida do STEP, troca de bobina)
+    };
+    // Liga o contador de ciclos, esvazia o buffer e devolve o par de referência
+    // (ciclos e us lidos juntos) para converter ciclos no tempo do ticker
+    void traceStart(uint32_t& ciclos, uint32_t& us);
+    // Copia até max bordas ainda não lidas; perdidas soma as sobrescritas pela ISR
+    // antes da leitura. Qualquer thread (um só leitor).
+    int  traceRead(Marca* dst, int max, uint32_t& perdidas);
+#endif
+
+protected:
+    virtual void handler();
+
+private:
+    struct Canal {
+        // hardware
+        DigitalOut*    step   = nullptr;
+        DigitalOut*    dir    = nullptr;
+        DigitalOut*    enable = nullptr;
+        BusOut*        coils  = nullptr;
+        const uint8_t* seq    = nullptr;
+        int            seqLen = 0;
+        int            seqIdx = 0;
+        int            passo  = 1;       // unidades de posição por entrada de seq
+        DigitalIn*     endMin = nullptr;
+        DigitalIn*     endMax = nullptr;
+
+        // estado do movimento
+        volatile bool    ativo     = false;
+        volatile bool    limite    = false;  // parou por fim de curso
+        volatile int32_t posicao   = 0;
+        volatile bool    continuo  = false;  // jog: sem contagem de eventos
+        bool             zeraMax   = false;  // fim de curso frente → posição 0
+        bool             nivel     = false;  // nível atual do pino STEP
+        int              sentido   = 0;      // 0 → frente, 1 → trás
+        uint32_t         restantes = 0;      // eventos até o fim do movimento
+        int32_t          alvo      = 0;      // posição final pedida (registro de eventos)
+
+        // rampa configurada: tabela de períodos por evento a partir do repouso e
+        // idxMax, a primeira entrada que alcança o período mínimo
+        const uint16_t*           rampa    = nullptr;
+        int                       rampaLen = 0;
+        std::chrono::microseconds minimo{1000};
+        int                       idxMax   = 0;
+
+        // tabela em uso no movimento atual (rampa configurada ou curva S);
+        // indice é a entrada corrente, piso o menor período permitido e saida a
+        // entrada em que o movimento termina (0 → parado; >0 → junção da fila)
+        const uint16_t*           tab    = nullptr;
+        int                       tabMax = 0;
+        std::chrono::microseconds piso{0};
+        int                       indice = -1;
+        int                       saida  = 0;
+
+        // interpolação de Bresenham (escravo segue os passos do mestre)
+        int     mestre = -1;
+        int32_t erro = 0, dEscravo = 0, dMestre = 0;
+
+        TickerDataClock::time_point prox;
+    };
+
+    void prepare(int id, int dir);
+    bool setupMove(int id, int32_t target);
+    int  setupLinear(int32_t tx, int32_t ty);
+    void useCurve(Canal& c, const uint16_t* curva, int len);
+    void start(int id, TickerDataClock::time_point base);
+    void arm(TickerDataClock::time_point t);
+    void reschedule();
+    void feed(TickerDataClock::time_point t);
+    bool canStart(const Segmento& s) const;
+    bool held(int id) const;
+    void abortQueue();
+    void release(Canal& c);
+    void notify(int id, bool falha);
+    void setLimitIndex(Canal& c);
+    void finish(int id);
+    void event(int id);
+    bool atLimit(const Canal& c) const;
+    std::chrono::microseconds nextPeriod(Canal& c);
+#if STEP_TRACE
+    void mark(int id, bool passo, TickerDataClock::time_point prazo);
+#endif
+
+    Canal                       _canal[STEP_EIXOS];
+    volatile uint32_t           _versao;    // muda a cada evento da ISR e em setPosition
+    bool                        _agendado;  // timer armado
+    TickerDataClock::time_point _prazo;     // instante do evento armado
+
+    mbed::Callback<void(int, bool)> _aviso;
+
+    // execução da fila do planejador
+    Planner*                    _planner;
+    DigitalOut*                 _valvula;
+    volatile bool               _emFila;
+    volatile bool               _falha;
+    bool                        _esperando; // trecho ESPERA em curso
+    TickerDataClock::time_point _fimEspera;
+    int32_t                     _zSeguro;   // altura Z livre de colisão durante o XY
+
+#if STEP_TRACE
+    Marca             _marcas[STEP_TRACE_TAM];
+    volatile uint32_t _traceEscrita = 0;   // total de bordas gravadas pela ISR
+    uint32_t          _traceLeitura = 0;   // total já entregue por traceRead
+#endif
+};
+
+#endif // STEPENGINE_H
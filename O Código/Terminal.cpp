@@ -0,0 +1,351 @@
+#include "Terminal.h"
+#include "Pipetadora.h"
+#include "Protocolo.h"
+
+using namespace std::chrono_literals;
+
+static_assert((TERMINAL_RX & (TERMINAL_RX - 1)) == 0, "TERMINAL_RX deve ser potência de 2");
+
+#define FIM_LINHA '\n'
+#define PERDIDA   '\x18'   // fim de uma linha descartada pela ISR (buffer cheio)
+
+static UnbufferedSerial uart(USBTX, USBRX, TERMINAL_BAUD);
+
+// O printf do resto do firmware sai pela mesma UART
+namespace mbed {
+FileHandle* mbed_override_console(int fd) {
+    (void) fd;
+    return &uart;
+}
+}
+
+// — Recepção: só a ISR escreve rxCauda, só a thread escreve rxCabeca
+static char              rx[TERMINAL_RX];
+static volatile uint32_t rxCabeca;       // início da linha mais antiga sem resposta
+static volatile uint32_t rxCauda;        // próximo byte livre
+static volatile uint32_t rxLinhas;       // linhas completas no buffer
+static volatile uint32_t rxPerdidas;     // linhas descartadas sem espaço nem para a marca
+static uint32_t          rxInicioLinha;  // (ISR) início da linha em recepção
+static bool              rxDescartando;  // (ISR) linha sem espaço: descarta até o '\n'
+static volatile bool     pedidoStatus;
+
+// Thread do terminal: abaixo da de movimento, acima da interface
+static Thread terminal(osPriorityAboveNormal, 1536, nullptr, "terminal");
+static constexpr uint32_t FLAG_RX = 1;
+
+// — Estado modal: alvo em passos (Z em meios passos) e coordenadas relativas
+static int32_t  alvo[3];
+static bool     relativo = false;
+static uint32_t enviadas;   // instruções passadas à thread de movimento
+
+static const char* const ERRO_ALARME = "alarme (M999)";
+
+//Um byte por interrupção de RX; '?' e '!' são atendidos na hora, fora do buffer
+static void isrRx(void) {
+    char c;
+    if (uart.read(&c, 1) != 1) return;
+    if (c == '?') {
+        pedidoStatus = true;
+        terminal.flags_set(FLAG_RX);
+        return;
+    }
+    if (c == '!') {
+        Pipetadora_Emergency();
+        Protocolo_Alarmar();
+        return;
+    }
+    if (c == '\r') return;
+
+    uint32_t cauda = rxCauda;
+    if (rxDescartando) {
+        if (c != FIM_LINHA) return;
+        // a linha perdida ainda recebe sua resposta, na ordem das outras
+        rxDescartando = false;
+        if (cauda - rxCabeca >= TERMINAL_RX) {
+            core_util_atomic_incr_u32(&rxPerdidas, 1);
+        } else {
+            rx[cauda % TERMINAL_RX] = PERDIDA;
+            rxCauda = rxInicioLinha = cauda + 1;
+            core_util_atomic_incr_u32(&rxLinhas, 1);
+        }
+        terminal.flags_set(FLAG_RX);
+        return;
+    }
+    if (cauda - rxCabeca >= TERMINAL_RX) {
+        // cheio no meio da linha: o host passou do orçamento; a linha toda sai
+        rxCauda = rxInicioLinha;
+        rxDescartando = true;
+        return;
+    }
+    rx[cauda % TERMINAL_RX] = c;
+    rxCauda = cauda + 1;
+    if (c == FIM_LINHA) {
+        rxInicioLinha = cauda + 1;
+        core_util_atomic_incr_u32(&rxLinhas, 1);
+        terminal.flags_set(FLAG_RX);
+    }
+}
+
+static void responder(const char* formato, ...) {
+    char buf[80];
+    va_list args;
+    va_start(args, formato);
+    int n = vsnprintf(buf, sizeof(buf) - 2, formato, args);
+    va_end(args);
+    if (n < 0) return;
+    if (n > int(sizeof(buf)) - 3) n = sizeof(buf) - 3;
+    buf[n++] = '\r';
+    buf[n++] = '\n';
+    uart.write(buf, n);
+}
+
+// Posição em mm com 3 decimais, em inteiros: o minimal-printf do alvo não formata float
+struct PosicaoMm {
+    char eixo[3][14];
+};
+
+static void formatarMm(const Pipetadora_Telemetria& t, PosicaoMm& p) {
+    for (int i = 0; i < 3; ++i) {
+        int32_t  um  = int32_t(lroundf(t.mm[i] * 1000.0f));
+        uint32_t mod = (um < 0) ? 0u - uint32_t(um) : uint32_t(um);
+        // os três dígitos da fração montados à mão: o minimal-printf não
+        // respeita o '0' de "%03lu" e 1,005 mm não pode sair como "1.5"
+        int n = snprintf(p.eixo[i], sizeof(p.eixo[i]) - 3, "%s%lu.", (um < 0) ? "-" : "",
+                         (unsigned long)(mod / 1000));
+        uint32_t frac = mod % 1000;
+        char* d = &p.eixo[i][n];
+        d[0] = char('0' + frac / 100);
+        d[1] = char('0' + (frac / 10) % 10);
+        d[2] = char('0' + frac % 10);
+        d[3] = '\0';
+    }
+}
+
+static void atenderStatus(void) {
+    if (!pedidoStatus) return;
+    pedidoStatus = false;
+    Pipetadora_Telemetria t;
+    Pipetadora_GetTelemetry(&t);
+    const char* estado = Protocolo_Alarme() ? "alarme" : (t.movendo || t.emFila) ? "movendo" : "ocioso";
+    PosicaoMm p;
+    formatarMm(t, p);
+    responder("<%s X:%s Y:%s Z:%s fila:%lu>", estado, p.eixo[0], p.eixo[1], p.eixo[2],
+              (unsigned long)(enviadas - Protocolo_Executadas()));
+}
+
+// — Leitura da linha direto no buffer de recepção
+struct Leitor {
+    uint32_t i, fim;   // fim: índice do terminador
+    char atual() const { return (i != fim) ? rx[i % TERMINAL_RX] : FIM_LINHA; }
+    void avancar()     { if (i != fim) ++i; }
+};
+
+// Palavras da linha: um comando G/M e os eixos X, Y, Z e P
+struct Linha {
+    char  letra;      // 'G' ou 'M'; 0 sem comando
+    int   codigo;
+    bool  tem[4];
+    float valor[4];
+};
+
+//Número decimal com sinal (até 9 dígitos significativos, sem expoente)
+static bool numero(Leitor& l, float& v) {
+    static const float escala[10] = { 1e0f, 1e-1f, 1e-2f, 1e-3f, 1e-4f, 1e-5f, 1e-6f, 1e-7f, 1e-8f, 1e-9f };
+    bool negativo = false;
+    if (l.atual() == '-' || l.atual() == '+') {
+        negativo = (l.atual() == '-');
+        l.avancar();
+    }
+    uint32_t n = 0;
+    int digitos = 0, decimais = 0;
+    bool ponto = false;
+    for (;; l.avancar()) {
+        char ch = l.atual();
+        if (ch == '.' && !ponto) { ponto = true; continue; }
+        if (ch < '0' || ch > '9') break;
+        if (digitos == 9) {
+            if (!ponto) return false;   // inteiro grande demais
+            continue;                   // decimais além da precisão
+        }
+        n = n * 10 + uint32_t(ch - '0');
+        ++digitos;
+        if (ponto) ++decimais;
+    }
+    if (digitos == 0) return false;
+    v = n * escala[decimais];
+    if (negativo) v = -v;
+    return true;
+}
+
+static const char* interpretar(Leitor& l, Linha& c) {
+    c = Linha();
+    for (;;) {
+        char ch = l.atual();
+        if (ch == FIM_LINHA || ch == ';') return nullptr;
+        l.avancar();
+        if (ch == ' ' || ch == '\t') continue;
+        if (ch == '(') {
+            while (l.atual() != ')' && l.atual() != FIM_LINHA) l.avancar();
+            l.avancar();
+            continue;
+        }
+        if (ch >= 'a' && ch <= 'z') ch = char(ch - 'a' + 'A');
+        float v;
+        if (!numero(l, v)) return "numero esperado";
+        const char* eixos = "XYZP";
+        const char* e = strchr(eixos, ch);
+        if (ch == 'G' || ch == 'M') {
+            if (c.letra) return "dois comandos na linha";
+            c.letra  = ch;
+            c.codigo = int(v);
+        } else if (ch == 'N') {
+            // número de linha: ignorado
+        } else if (ch && e) {
+            c.tem[e - eixos]   = true;
+            c.valor[e - eixos] = v;
+        } else {
+            return "palavra desconhecida";
+        }
+    }
+}
+
+//Fila parada e nada pendente: o alvo volta a ser a posição real (o menu pode ter movido)
+static void sincronizar(void) {
+    if (Protocolo_Executadas() != enviadas) return;
+    Pipetadora_Telemetria t;
+    Pipetadora_GetTelemetry(&t);
+    if (t.movendo || t.emFila) return;
+    for (int i = 0; i < 3; ++i) alvo[i] = Pipetadora_GetPositionSteps(i);
+}
+
+// X e Y andam 2 unidades por passo (uma por borda do STEP): um alvo ímpar
+// passaria do ponto, então vai para o par mais próximo (empate: longe do zero)
+static int32_t eixoAlvo(const Linha& c, int id) {
+    if (!c.tem[id]) return alvo[id];
+    int32_t p = Pipetadora_MmToSteps(id, c.valor[id]);
+    int32_t a = relativo ? alvo[id] + p : p;
+    if (id < 2 && (a & 1)) a += (a > 0) ? 1 : -1;
+    return a;
+}
+
+//Fila de instruções cheia: a linha segura seus bytes no buffer e o host espera
+static void instruir(Instrucao::Tipo tipo, int32_t a = 0, int32_t b = 0, int32_t z = 0) {
+    Instrucao i = { tipo, { a, b, z } };
+    while (!Protocolo_Instruir(i)) {
+        atenderStatus();
+        ThisThread::sleep_for(1ms);
+    }
+    ++enviadas;
+}
+
+//Para G28, M400 e M999: a resposta só sai com a instrução executada
+static bool esperarExecucao(void) {
+    while (Protocolo_Executadas() != enviadas) {
+        atenderStatus();
+        ThisThread::sleep_for(5ms);
+    }
+    return !Protocolo_Alarme();
+}
+
+static const char* executarG(const Linha& c) {
+    switch (c.codigo) {
+        case 0:
+        case 1: {
+            if (Protocolo_Alarme()) return ERRO_ALARME;
+            bool xy = c.tem[0] || c.tem[1];
+            if (c.codigo == 1 && xy && c.tem[2]) return "G1 com XY e Z (use duas linhas)";
+            sincronizar();
+            int32_t x = eixoAlvo(c, 0), y = eixoAlvo(c, 1), z = eixoAlvo(c, 2);
+            if (c.codigo == 0 && xy) instruir(Instrucao::DESLOCAR, x, y, z);
+            else if (xy)             instruir(Instrucao::LINEAR, x, y);
+            else if (c.tem[2])       instruir(Instrucao::Z, 0, 0, z);
+            alvo[0] = x;
+            alvo[1] = y;
+            alvo[2] = z;
+            return nullptr;
+        }
+        case 4:
+            if (!c.tem[3] || c.valor[3] < 0) return "G4 sem P<ms>";
+            if (Protocolo_Alarme()) return ERRO_ALARME;
+            instruir(Instrucao::PAUSA, int32_t(c.valor[3]));
+            return nullptr;
+        case 28:
+            if (Protocolo_Alarme()) return ERRO_ALARME;
+            instruir(Instrucao::HOMING);
+            if (!esperarExecucao()) return ERRO_ALARME;
+            sincronizar();
+            return nullptr;
+        case 90: relativo = false; return nullptr;
+        case 91: relativo = true;  return nullptr;
+    }
+    return "comando desconhecido";
+}
+
+static const char* executarM(const Linha& c) {
+    switch (c.codigo) {
+        case 8:
+            if (Protocolo_Alarme()) return ERRO_ALARME;
+            instruir(Instrucao::VALVULA);
+            return nullptr;
+        case 112:
+            Pipetadora_Emergency();
+            Protocolo_Alarmar();
+            return nullptr;
+        case 114: {
+            Pipetadora_Telemetria t;
+            Pipetadora_GetTelemetry(&t);
+            PosicaoMm p;
+            formatarMm(t, p);
+            responder("X:%s Y:%s Z:%s", p.eixo[0], p.eixo[1], p.eixo[2]);
+            return nullptr;
+        }
+        case 400:
+            if (Protocolo_Alarme()) return ERRO_ALARME;
+            instruir(Instrucao::ESPERAR);
+            return esperarExecucao() ? nullptr : ERRO_ALARME;
+        case 999:
+            instruir(Instrucao::REARMAR);
+            esperarExecucao();
+            return nullptr;
+    }
+    return "comando desconhecido";
+}
+
+//Interpreta e executa a linha mais antiga; os bytes só são liberados antes da
+//resposta, então o host nunca tem mais que TERMINAL_RX bytes sem resposta
+static void processarLinha(void) {
+    Leitor l = { rxCabeca, rxCabeca };
+    while (rx[l.fim % TERMINAL_RX] != FIM_LINHA && rx[l.fim % TERMINAL_RX] != PERDIDA) ++l.fim;
+
+    const char* erro;
+    Linha c;
+    if (rx[l.fim % TERMINAL_RX] == PERDIDA)  erro = "linha perdida (buffer cheio)";
+    else if ((erro = interpretar(l, c)))     {}
+    else if (c.letra == 'G')                 erro = executarG(c);
+    else if (c.letra == 'M')                 erro = executarM(c);
+    else if (c.tem[0] || c.tem[1] || c.tem[2] || c.tem[3]) erro = "comando ausente";
+
+    rxCabeca = l.fim + 1;
+    core_util_atomic_decr_u32(&rxLinhas, 1);
+    if (erro) responder("error: %s", erro);
+    else      responder("ok");
+}
+
+static void threadTerminal(void) {
+    for (;;) {
+        atenderStatus();
+        if (rxLinhas) {
+            processarLinha();
+        } else if (rxPerdidas) {
+            core_util_atomic_decr_u32(&rxPerdidas, 1);
+            responder("error: linha perdida (buffer cheio)");
+        } else {
+            ThisThread::flags_wait_any(FLAG_RX);
+        }
+    }
+}
+
+void Terminal_Start(void) {
+    terminal.start(callback(threadTerminal));
+    uart.attach(callback(isrRx), SerialBase::RxIrq);
+}
@@ -0,0 +1,39 @@
+// Terminal.h
+// Terminal de comandos em texto (estilo G-code) na porta serial virtual do
+// ST-LINK (USBTX/USBRX), que também passa a ser o console do printf.
+//
+// A ISR de recepção grava cada byte num buffer circular; a thread do terminal
+// interpreta as linhas completas direto no buffer (sem cópia), passa as
+// instruções para a thread de movimento e só então libera os bytes da linha e
+// responde "ok" (ou "error: motivo"). Controle de fluxo por contagem de
+// caracteres: o host mantém no máximo TERMINAL_RX bytes de linhas sem resposta
+// e envia as seguintes sem esperar cada ok, então a fila de trechos nunca seca
+// por causa da ida e volta da serial.
+//
+//   G0 X Y Z    deslocamento: Z ao topo, XY, desce ao Z (mm; eixos omitidos ficam)
+//   G1 X Y      linha reta no XY (trechos seguidos são encadeados)
+//   G1 Z        só o Z
+//   G4 P<ms>    pausa
+//   G28         homing; responde ao terminar
+//   G90 / G91   coordenadas absolutas / relativas
+//   M8          pulso da válvula
+//   M114        posição atual: "X:.. Y:.. Z:.." antes do ok
+//   M400        espera a fila esvaziar; responde ao terminar
+//   M112        parada imediata (entra em alarme)
+//   M999        sai do alarme; responde ao terminar
+// Bytes de tempo real, fora da contagem e de qualquer linha:
+//   '?'  status "<ocioso|movendo|alarme X:.. Y:.. Z:.. fila:n>"
+//   '!'  parada imediata (como M112)
+// Comentários: ';' até o fim da linha e '(...)'; '\r' é ignorado.
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include "mbed.h"
+
+#define TERMINAL_BAUD 115200
+#define TERMINAL_RX   256      // buffer de recepção (potência de 2): orçamento do host
+
+// Abre a UART e cria a thread do terminal; chamar após Protocolo_Start
+void Terminal_Start(void);
+
+#endif // TERMINAL_H
@@ -4,7 +4,11 @@
 #include "TextLCD.h"
 #include "pinos.h"
 #include "Pipetadora.h"
-#define MAX_POINTS 9 //Definição de pontos maximos para solta
+#include "Protocolo.h"
+#include "Menu.h"
+#include "Perfil.h"
+#include "Registro.h"
+#include "Terminal.h"
 
 DigitalIn switchSelectDisp(SWITCH_PIN, PullDown);
 
@@ -27,47 +31,86 @@ Timer debounceTimer;
 const auto debounceTimeMs = 200ms;
 
 // --- Estruturas para volumes e posições ---
-typedef struct { int32_t pos[3]; } Ponto;
 static Ponto pontosColeta;
 static Ponto pontosSolta[MAX_POINTS];
 static int  volumeSolta[MAX_POINTS] = {0};
 // -----------------------------------------
 
 static bool homed = false; //Checagem do referenciamento
-static int  cursor    = 0; //Posição do cursor do menu
-static bool inSubmenu = false; //Checagem do menu secundario
 static bool upFlag, downFlag, enterFlag, backFlag; //Flags de botões
 static int  numSolta  = 0; //Contagem de quantos pontos de solta estão setados
 static volatile bool emergActive = false; //Checa emergencia
 
-// Definições do menu e submenu
-#define MAIN_COUNT 3
-#define SUB_COUNT  4
-#define SUB_VISIBLE  3
-const char* mainMenu[MAIN_COUNT] = { "Referenciamento", "Mov Manual", "Pipetadora" };
-const char* subMenu[SUB_COUNT]  = { "Config Coleta", "Config Solta", "Reset Mem", "Iniciar" };
+// Ações dos menus (Enter)
+void acaoReferenciar();
+void acaoManual();
+void acaoPipetadora();
+void acaoColeta();
+void acaoSolta();
+void acaoReset();
+void acaoIniciar();
+void acaoPerfil();
+
+// Definições do menu e submenu: tabelas fixas, o Menu cuida do cursor e da janela
+extern const MenuDef menuPrincipal;
+const MenuItem itensPrincipal[] = {
+    { "Referenciamento", acaoReferenciar },
+    { "Mov Manual",      acaoManual },
+    { "Pipetadora",      acaoPipetadora },
+    { "Perfil CPU",      acaoPerfil },
+};
+const MenuDef menuPrincipal = { "MENU PRINCIPAL", 3, itensPrincipal, MENU_NUM(itensPrincipal), nullptr };
+const MenuItem itensPipetadora[] = {
+    { "Config Coleta", acaoColeta },
+    { "Config Solta",  acaoSolta },
+    { "Reset Mem",     acaoReset },
+    { "Iniciar",       acaoIniciar },
+};
+const MenuDef menuPipetadora = { "PIPETADORA", 3, itensPipetadora, MENU_NUM(itensPipetadora), &menuPrincipal };
+
+Menu menu(lcd);
 
 // ISR handlers
-void isrEmergPress()   { emergActive = true; }
-void isrEmergRelease() { emergActive = false; }
-void isrUp()    { if (debounceTimer.elapsed_time() >= debounceTimeMs) { debounceTimer.reset(); upFlag    = true; } }
-void isrDown()  { if (debounceTimer.elapsed_time() >= debounceTimeMs) { debounceTimer.reset(); downFlag  = true; } }
-void isrEnter() { if (debounceTimer.elapsed_time() >= debounceTimeMs) { debounceTimer.reset(); enterFlag = true; } }
-void isrBack()  { if (debounceTimer.elapsed_time() >= debounceTimeMs) { debounceTimer.reset(); backFlag  = true; } }
+PERFIL_DEFINIR(perfEmerg,  "emerg");
+PERFIL_DEFINIR(perfBotoes, "botoes");
+void isrEmergPress()   { PERFIL_MEDIR(perfEmerg); emergActive = true; Pipetadora_Emergency(); }
+void isrEmergRelease() { emergActive = false; Registro_Gravar(REG_EMERGENCIA, REGISTRO_SEM_EIXO, 0, 0, 0); }
+void isrUp()    { PERFIL_MEDIR(perfBotoes); if (debounceTimer.elapsed_time() >= debounceTimeMs) { debounceTimer.reset(); upFlag    = true; } }
+void isrDown()  { PERFIL_MEDIR(perfBotoes); if (debounceTimer.elapsed_time() >= debounceTimeMs) { debounceTimer.reset(); downFlag  = true; } }
+void isrEnter() { PERFIL_MEDIR(perfBotoes); if (debounceTimer.elapsed_time() >= debounceTimeMs) { debounceTimer.reset(); enterFlag = true; } }
+void isrBack()  { PERFIL_MEDIR(perfBotoes); if (debounceTimer.elapsed_time() >= debounceTimeMs) { debounceTimer.reset(); backFlag  = true; } }
+
+// --- Comunicação com a thread de movimento ---
+static int pendentes = 0; //Comandos enviados ainda sem FIM
+
+// Envia um comando à thread de movimento
+void enviarComando(Comando::Tipo tipo) {
+    Comando c = { tipo, nullptr, nullptr, nullptr, 0 };
+    if (tipo == Comando::PIPETAR) {
+        c.coleta = &pontosColeta; c.solta = pontosSolta; c.volume = volumeSolta; c.numSolta = numSolta;
+    }
+    while (!Protocolo_Send(c)) ThisThread::sleep_for(10ms);
+    ++pendentes;
+}
+
+// Espera o FIM de todos os comandos enviados; retorna o resultado do último
+bool esperarFim() {
+    bool ok = true;
+    Status s;
+    while (pendentes > 0) {
+        if (!Protocolo_Poll(s)) { ThisThread::sleep_for(10ms); continue; }
+        if (s.tipo == Status::FIM) { --pendentes; ok = s.ok; }
+    }
+    return ok;
+}
 
 // Desenha menu inicial animado
 void drawMainMenuAnim() {
     lcd.cls();
     lcd.locate(5,1); lcd.printf("Carregando...");
+    lcd.flush();
     thread_sleep_for(500);
-    lcd.cls();
-    lcd.locate(3,0); lcd.printf("MENU PRINCIPAL");
-    for (int i = 0; i < MAIN_COUNT; ++i) {
-        lcd.locate(1, i+1);
-        lcd.printf("%s", mainMenu[i]);
-    }
-    cursor = 0; inSubmenu = false;
-    lcd.locate(0,1); lcd.putc('>');
+    menu.open(menuPrincipal);
 }
 
 // Zera homing e pontos
@@ -81,38 +124,257 @@ void clearMemory() {
     numSolta = 0;
 }
 
-// Desenha menu principal
-void drawMainMenu() {
-    lcd.cls();
-    lcd.locate(3,0); lcd.printf("MENU PRINCIPAL");
-    for (int i = 0; i < MAIN_COUNT; ++i) {
-        lcd.locate(1, i+1);
-        lcd.printf("%s", mainMenu[i]);
+// Tela de status da pipetagem automática: campos de largura fixa sobrescritos
+// no lugar (sem cls), então só as células que mudaram vão ao LCD
+void drawStatus(int ponto, int feitosMl, int totalMl, int restanteS) {
+    Pipetadora_Telemetria t;
+    Pipetadora_GetTelemetry(&t);
+    lcd.locate(0,0); lcd.printf("X%6.1f Y%6.1f mm", t.mm[0], t.mm[1]);
+    lcd.locate(0,1); lcd.printf("Z%6.1f mm  Poco %d/%d", t.mm[2], ponto+1, numSolta);
+    lcd.locate(0,2); lcd.printf("Vol %3d/%3d mL ", feitosMl, totalMl);
+    lcd.putBar(feitosMl, totalMl, 5);  //5 células, 3 traços cada; a CGRAM só é escrita na primeira vez
+    lcd.locate(0,3);
+    if (restanteS < 0) lcd.printf("Resta --:--");
+    else               lcd.printf("Resta %02d:%02d", restanteS / 60, restanteS % 60);
+    lcd.locate(19,3);
+    if (t.movendo) lcd.putIcon(udc_0);  //|> enquanto algum eixo anda
+    else           lcd.putc(' ');
+    lcd.flush();
+}
+
+// Tela do perfil: janela de medida e os três escopos de maior ocupação
+// (nome, % de CPU, pior caso em us), sobrescritos no lugar como o status
+void drawPerfil() {
+    const PerfilEscopo* top[3] = { nullptr, nullptr, nullptr };
+    for (int i = 0; i < Perfil_Num(); ++i) {
+        const PerfilEscopo* e = Perfil_Get(i);
+        for (int k = 0; k < 3; ++k) {
+            if (top[k] == nullptr || e->total > top[k]->total) {
+                for (int j = 2; j > k; --j) top[j] = top[j-1];
+                top[k] = e;
+                break;
+            }
+        }
     }
-    lcd.locate(0,1 + cursor); lcd.putc('>');
+    lcd.locate(0,0); lcd.printf("Perfil CPU  %6lus", (unsigned long)(Perfil_JanelaMs() / 1000));
+    for (int k = 0; k < 3; ++k) {
+        lcd.locate(0,k+1);
+        if (top[k] == nullptr) { lcd.printf("%20s", ""); continue; }
+        unsigned long cpu = Perfil_Ocupacao(top[k]);
+        unsigned long max = Perfil_Us(top[k]->maximo);
+        lcd.printf("%-8s%3lu.%lu%%%4luus", top[k]->nome, cpu / 10, cpu % 10, max > 9999 ? 9999 : max);
+    }
+    lcd.flush();
 }
 
-// Desenha submenu Pipetadora
-void drawSubMenu() {
-    lcd.cls();
-    lcd.locate(3,0); lcd.printf("PIPETADORA");
-    int windowStart = cursor < SUB_VISIBLE
-                    ? 0
-                    : (cursor > SUB_COUNT - SUB_VISIBLE
-                       ? SUB_COUNT - SUB_VISIBLE
-                       : cursor - (SUB_VISIBLE - 1));
-    for (int i = 0; i < SUB_VISIBLE; ++i) {
-        int idx = windowStart + i;
-        lcd.locate(1, i+1); lcd.printf("%s", subMenu[idx]);
-        if (idx == cursor) {
-            lcd.locate(0, i+1); lcd.putc('>');
+// --- Ações dos menus ---
+
+// Referenciamento sempre em velocidade máxima
+void acaoReferenciar() {
+    lcd.cls(); lcd.printf("Referenciando..."); lcd.flush();
+    enviarComando(Comando::HOMING);
+    esperarFim();
+    homed = true;
+    menu.redraw();
+}
+
+// Movimento Manual
+void acaoManual() {
+    lcd.cls(); lcd.printf("Mov Manual");
+    bool lastSw = Pipetadora_GetToggleMode();
+    lcd.locate(17,0);
+    lcd.printf(lastSw ? "Z/Y" : "X/Y"); lcd.flush();
+    enviarComando(Comando::MANUAL);
+    while (!backFlag && !emergActive) {
+        ThisThread::sleep_for(20ms);
+        bool sw = Pipetadora_GetToggleMode();
+        if (sw != lastSw) {
+            lcd.locate(17,0);
+            lcd.printf(sw ? "Z/Y" : "X/Y"); lcd.flush();
+            lastSw = sw;
         }
     }
+    backFlag = false;
+    enviarComando(Comando::PARAR);
+    esperarFim();
+    menu.redraw();
+}
+
+// Submenu Pipetadora
+void acaoPipetadora() {
+    if (!homed) {
+        lcd.cls(); lcd.printf("Erro: Faca homing"); lcd.flush(); //Caso n tenha referenciado, mostra erro
+        ThisThread::sleep_for(800ms);
+        menu.redraw();
+    } else {
+        menu.open(menuPipetadora);
+    }
+}
+
+// Config Coleta
+void acaoColeta() {
+    lcd.cls(); lcd.printf("Posicione e Enter");
+    bool lastSw = Pipetadora_GetToggleMode();
+    lcd.locate(17,4);
+    lcd.printf(lastSw ? "Z/Y" : "X/Y"); lcd.flush();
+    enviarComando(Comando::MANUAL);
+    while (!enterFlag && !backFlag && !emergActive) {
+        ThisThread::sleep_for(20ms);
+        bool sw = Pipetadora_GetToggleMode();
+        if (sw != lastSw) {
+            lcd.locate(17,4);
+            lcd.printf(sw ? "Z/Y" : "X/Y"); lcd.flush();
+            lastSw = sw;
+        }
+    }
+    enviarComando(Comando::PARAR);
+    esperarFim();
+    if (enterFlag) {
+        //Salva coleta
+        pontosColeta.pos[0] = Pipetadora_GetPositionSteps(0);
+        pontosColeta.pos[1] = Pipetadora_GetPositionSteps(1);
+        pontosColeta.pos[2] = Pipetadora_GetPositionSteps(2);
+        lcd.cls(); lcd.printf("Coleta Salvo"); lcd.flush();
+        ThisThread::sleep_for(500ms);
+    }
+    enterFlag = backFlag = false;
+    menu.redraw();
+}
+
+// Config Solta
+void acaoSolta() {
+    enterFlag = backFlag = false;
+    lcd.cls(); lcd.printf("Qtd Solta:%d", numSolta); lcd.flush();
+    bool doneQtd = false;
+    while (!doneQtd && !emergActive) {
+        //Escolhe quantidade de pontos de solta
+        if (upFlag   && numSolta < MAX_POINTS) { numSolta++; lcd.cls(); lcd.printf("Qtd Solta:%d", numSolta); lcd.flush(); upFlag=false; }
+        if (downFlag && numSolta > 0)           { numSolta--; lcd.cls(); lcd.printf("Qtd Solta:%d", numSolta); lcd.flush(); downFlag=false; }
+        if (enterFlag) { enterFlag=false; doneQtd=true; }
+        if (backFlag)  { backFlag=false; doneQtd=true; numSolta=0; }
+        ThisThread::sleep_for(1ms);
+    }
+    //Para cada ponto de solta salva ml e posição
+    for (int i = 0; i < numSolta; ++i) {
+        lcd.cls(); lcd.printf("Mov PtoS %d", i+1);
+        bool lastSw = Pipetadora_GetToggleMode();
+        lcd.locate(17,4);
+        lcd.printf(lastSw ? "Z/Y" : "X/Y"); lcd.flush();
+        enviarComando(Comando::MANUAL);
+        while (!enterFlag && !backFlag && !emergActive) {
+            ThisThread::sleep_for(20ms);
+            bool sw = Pipetadora_GetToggleMode();
+            if (sw != lastSw) {
+                lcd.locate(17,4);
+                lcd.printf(sw ? "Z/Y" : "X/Y"); lcd.flush();
+                lastSw = sw;
+            }
+        }
+        enviarComando(Comando::PARAR);
+        esperarFim();
+        if (!enterFlag) { backFlag=false; break; }
+        enterFlag = false;
+        pontosSolta[i].pos[0] = Pipetadora_GetPositionSteps(0);
+        pontosSolta[i].pos[1] = Pipetadora_GetPositionSteps(1);
+        pontosSolta[i].pos[2] = Pipetadora_GetPositionSteps(2);
+        volumeSolta[i] = 1;
+        bool doneVol = false;
+        while (!doneVol && !backFlag && !emergActive) {
+            lcd.cls(); lcd.printf("Vol Pto%d:%d mL", i+1, volumeSolta[i]); lcd.flush();
+            if (upFlag)   { volumeSolta[i]++; upFlag=false; }
+            if (downFlag && volumeSolta[i]>1) { volumeSolta[i]--; downFlag=false; }
+            if (enterFlag) { enterFlag=false; doneVol=true; }
+            ThisThread::sleep_for(50ms);
+        }
+        lcd.cls(); lcd.printf("Salvo S%d", i+1); lcd.flush();
+        ThisThread::sleep_for(300ms);
+    }
+    menu.redraw();
+}
+
+// Reset Memória
+void acaoReset() {
+    clearMemory();
+    lcd.cls(); lcd.printf("Memória limpa"); lcd.flush();
+    ThisThread::sleep_for(500ms);
+    menu.redraw();
+}
+
+// Iniciar Pipetagem
+void acaoIniciar() {
+    if (pontosColeta.pos[2]==0 && pontosColeta.pos[0]==0 && pontosColeta.pos[1]==0) {
+        lcd.cls(); lcd.printf("Erro: Coleta?"); lcd.flush();
+        ThisThread::sleep_for(800ms);
+        menu.redraw();
+        return;
+    }
+    //Começa a pipetagem automatica na thread de movimento
+    enviarComando(Comando::PIPETAR);
+    bool ok = false;
+    {
+        //Cada ciclo de aspirar/dispensar leva 1 mL
+        int totalMl = 0;
+        for (int i = 0; i < numSolta; ++i) totalMl += volumeSolta[i];
+        int ponto = 0, feitosMl = 0;
+        Timer decorrido, tela;
+        decorrido.start(); tela.start();
+        lcd.cls();
+        drawStatus(ponto, feitosMl, totalMl, -1);
+
+        Status st;
+        while (pendentes > 0 && !emergActive) {
+            if (Protocolo_Poll(st)) {
+                if (st.tipo == Status::FIM) { --pendentes; ok = st.ok; break; }
+                //PROGRESSO chega no início de cada ciclo
+                ponto = st.ponto;
+                feitosMl = st.feitos;
+                for (int i = 0; i < st.ponto; ++i) feitosMl += volumeSolta[i];
+                continue;
+            }
+            //Tela a 5 Hz; o tempo restante segue a média dos ciclos já feitos
+            if (tela.elapsed_time() >= 200ms) {
+                tela.reset();
+                int restanteS = -1;
+                if (feitosMl > 0) {
+                    auto s = duration_cast<seconds>(decorrido.elapsed_time()).count();
+                    restanteS = int(s * (totalMl - feitosMl) / feitosMl);
+                    if (restanteS > 5999) restanteS = 5999; //mm:ss
+                }
+                drawStatus(ponto, feitosMl, totalMl, restanteS);
+            }
+            ThisThread::sleep_for(50ms);
+        }
+    }
+    if (emergActive) return;
+    lcd.cls(); lcd.printf(ok ? "Concluido" : "Erro: movimento"); lcd.flush();
+    ThisThread::sleep_for(800ms);
+    if (!ok) Registro_Dump();  //últimos eventos do movimento para o console
+    Pipetadora_TraceDump();  //bordas de passo capturadas (só com STEP_TRACE) vão para o console
+    menu.open(menuPrincipal);
+}
+
+// Perfil CPU: a tabela completa vai para o console ao entrar e a tela se
+// atualiza a cada segundo. Enter zera a medida, Back volta.
+void acaoPerfil() {
+    Perfil_Dump();
+    enterFlag = backFlag = false;
+    lcd.cls();
+    while (!backFlag && !emergActive) {
+        if (enterFlag) { enterFlag = false; Perfil_Reset(); }
+        drawPerfil();
+        for (int i = 0; i < 20 && !enterFlag && !backFlag && !emergActive; ++i) ThisThread::sleep_for(50ms);
+    }
+    backFlag = false;
+    menu.redraw();
 }
 
 //Inicialização da maquina
 int main() {
     Pipetadora_InitMotors();
+    Protocolo_Start();
+    Terminal_Start();         //Comandos G-code pela serial do ST-LINK
+    lcd.setFrameBuffer(true); //Redesenhos só enviam as células alteradas
+    lcd.setRefresh(20);       //Thread de fundo envia a tela 20x por segundo; a interface não espera o I2C
     debounceTimer.start();
     buttonUp.rise(&isrUp);
     buttonDown.rise(&isrDown);
@@ -121,223 +383,38 @@ int main() {
     buttonEmerg.fall(&isrEmergPress);
     buttonEmerg.rise(&isrEmergRelease);
     drawMainMenuAnim();
-    drawMainMenu();
 
     //Loop principal
     while (true) {
         // 1) Emergência
         if (emergActive) {
-            Pipetadora_StopAll();
-            lcd.cls(); lcd.printf("!!! EMERGENCIA !!!");
+            // os eixos já pararam na ISR; a thread de movimento limpa a fila
+            enviarComando(Comando::PARAR);
+            esperarFim();
+            Registro_Dump();
+            lcd.cls(); lcd.printf("!!! EMERGENCIA !!!"); lcd.flush();
             // espera até o botão de emergência ser solto
             while (emergActive) ThisThread::sleep_for(50ms);
             // solicita confirmação de ENTER para voltar ao menu principal
-            lcd.cls(); lcd.printf("Aperte ENTER");
+            lcd.cls(); lcd.printf("Aperte ENTER"); lcd.flush();
             enterFlag = false;                          // zera flag de ENTER
             while (!enterFlag) ThisThread::sleep_for(50ms);
             enterFlag = false;                          // consome o ENTER
             clearMemory();
-            cursor = 0; inSubmenu = false;
-            drawMainMenu();
+            menu.open(menuPrincipal);
             continue;
         }
 
 
-        // 2) Navegação
-        if (!inSubmenu) {
-            if (upFlag)   { cursor = (cursor-1+MAIN_COUNT)%MAIN_COUNT; drawMainMenu(); upFlag=false; }
-            else if (downFlag) { cursor = (cursor+1)%MAIN_COUNT; drawMainMenu(); downFlag=false; }
-            else if (backFlag) { backFlag=false; }
-        } else {
-            if (upFlag)   { cursor = (cursor-1+SUB_COUNT)%SUB_COUNT; drawSubMenu(); upFlag=false; }
-            else if (downFlag) { cursor = (cursor+1)%SUB_COUNT; drawSubMenu(); downFlag=false; }
-            else if (backFlag) { backFlag=false; inSubmenu=false; cursor=0; drawMainMenu(); }
-        }
+        // 2) Navegação: o Menu só reescreve o '>' e as linhas que rolam
+        if (upFlag)        { upFlag=false;   menu.up(); }
+        else if (downFlag) { downFlag=false; menu.down(); }
+        else if (backFlag) { backFlag=false; menu.back(); }
 
         // 3) Ação Enter
         if (enterFlag) {
             enterFlag = false;
-            if (!inSubmenu) {
-                switch (cursor) {
-                    case 0: { // Referenciamento sempre em velocidade máxima
-                        lcd.cls(); lcd.printf("Referenciando...");
-                        Pipetadora_Homing();
-                        homed = true;
-                        drawMainMenu();
-                        break;
-                    }
-
-                    case 1: { // Movimento Manual
-                        lcd.cls(); lcd.printf("Mov Manual");
-                        bool lastSw = Pipetadora_GetToggleMode();
-                        lcd.locate(17,0);
-                        lcd.printf(lastSw ? "Z/Y" : "X/Y");
-                        while (!backFlag && !emergActive) {
-                            Pipetadora_ManualControl();
-                            bool sw = Pipetadora_GetToggleMode();
-                            if (sw != lastSw) {
-                                lcd.locate(17,0);
-                                lcd.printf(sw ? "Z/Y" : "X/Y");
-                                lastSw = sw;
-                            }
-                        }
-                        backFlag = false;
-                        Pipetadora_StopAll();
-                        drawMainMenu();
-                        break;
-                    }
-
-                    case 2:  // Submenu Pipetadora
-                        if (!homed) {
-                            lcd.cls(); lcd.printf("Erro: Faca homing"); //Caso n tenha referenciado, mostra erro
-                            ThisThread::sleep_for(800ms);
-                            drawMainMenu();
-                        } else {
-                            inSubmenu = true;
-                            cursor = 0;
-                            drawSubMenu();
-                        }
-                        break;
-                }
-            } else {
-                switch (cursor) {
-                    case 0: { // Config Coleta
-                        lcd.cls(); lcd.printf("Posicione e Enter");
-                        bool lastSw = Pipetadora_GetToggleMode();
-                        lcd.locate(17,4);
-                        lcd.printf(lastSw ? "Z/Y" : "X/Y");
-                        while (!enterFlag && !backFlag && !emergActive) {
-                            Pipetadora_ManualControl();
-                            bool sw = Pipetadora_GetToggleMode();
-                            if (sw != lastSw) {
-                                lcd.locate(17,4);
-                                lcd.printf(sw ? "Z/Y" : "X/Y");
-                                lastSw = sw;
-                            }
-                        }
-                        if (enterFlag) {
-                            //Salva coleta
-                            pontosColeta.pos[0] = Pipetadora_GetPositionSteps(0);
-                            pontosColeta.pos[1] = Pipetadora_GetPositionSteps(1);
-                            pontosColeta.pos[2] = Pipetadora_GetPositionSteps(2);
-                            lcd.cls(); lcd.printf("Coleta Salvo");
-                            ThisThread::sleep_for(500ms);
-                        }
-                        enterFlag = backFlag = false;
-                        drawSubMenu();
-                        break;
-                    }
-
-                    case 1: { // Config Solta
-                        enterFlag = backFlag = false;
-                        lcd.cls(); lcd.printf("Qtd Solta:%d", numSolta);
-                        bool doneQtd = false;
-                        while (!doneQtd && !emergActive) {
-                            //Escolhe quantidade de pontos de solta
-                            if (upFlag   && numSolta < MAX_POINTS) { numSolta++; lcd.cls(); lcd.printf("Qtd Solta:%d", numSolta); upFlag=false; }
-                            if (downFlag && numSolta > 0)           { numSolta--; lcd.cls(); lcd.printf("Qtd Solta:%d", numSolta); downFlag=false; }
-                            if (enterFlag) { enterFlag=false; doneQtd=true; }
-                            if (backFlag)  { backFlag=false; doneQtd=true; numSolta=0; }
-                            ThisThread::sleep_for(1ms);
-                        }
-                        //Para cada ponto de solta salva ml e posição
-                        for (int i = 0; i < numSolta; ++i) {
-                            lcd.cls(); lcd.printf("Mov PtoS %d", i+1);
-                            bool lastSw = Pipetadora_GetToggleMode();
-                            lcd.locate(17,4);
-                            lcd.printf(lastSw ? "Z/Y" : "X/Y");
-                            while (!enterFlag && !backFlag && !emergActive) {
-                                Pipetadora_ManualControl();
-                                bool sw = Pipetadora_GetToggleMode();
-                                if (sw != lastSw) {
-                                    lcd.locate(17,4);
-                                    lcd.printf(sw ? "Z/Y" : "X/Y");
-                                    lastSw = sw;
-                                }
-                            }
-                            if (!enterFlag) { backFlag=false; break; }
-                            enterFlag = false;
-                            pontosSolta[i].pos[0] = Pipetadora_GetPositionSteps(0);
-                            pontosSolta[i].pos[1] = Pipetadora_GetPositionSteps(1);
-                            pontosSolta[i].pos[2] = Pipetadora_GetPositionSteps(2);
-                            volumeSolta[i] = 1;
-                            bool doneVol = false;
-                            while (!doneVol && !backFlag && !emergActive) {
-                                lcd.cls(); lcd.printf("Vol Pto%d:%d mL", i+1, volumeSolta[i]);
-                                if (upFlag)   { volumeSolta[i]++; upFlag=false; }
-                                if (downFlag && volumeSolta[i]>1) { volumeSolta[i]--; downFlag=false; }
-                                if (enterFlag) { enterFlag=false; doneVol=true; }
-                                ThisThread::sleep_for(50ms);
-                            }
-                            lcd.cls(); lcd.printf("Salvo S%d", i+1);
-                            ThisThread::sleep_for(300ms);
-                        }
-                        drawSubMenu();
-                        break;
-                    }
-
-                    case 2: { // Reset Memória
-                        clearMemory();
-                        lcd.cls(); lcd.printf("Memória limpa");
-                        ThisThread::sleep_for(500ms);
-                        drawSubMenu();
-                        break;
-                    }
-
-                    case 3: { // Iniciar Pipetagem
-                        if (pontosColeta.pos[2]==0 && pontosColeta.pos[0]==0 && pontosColeta.pos[1]==0) {
-                            lcd.cls(); lcd.printf("Erro: Coleta?");
-                            ThisThread::sleep_for(800ms);
-                            drawSubMenu();
-                            break;
-                        }
-                        //Começa a pipetagem automatica
-                        lcd.cls(); lcd.printf("Iniciando...");
-                        ThisThread::sleep_for(300ms);
-                        Pipetadora_MoveTo(2, 0);
-                        ThisThread::sleep_for(50ms);
-                        for (int j=0; j<numSolta && !emergActive; ++j) {
-                            int needed = volumeSolta[j];
-                            int done   = 0;
-                            while (done < needed && !emergActive) {
-                                // Aspirar
-                                Pipetadora_MoveLinear(pontosColeta.pos[0], pontosColeta.pos[1]);
-                                ThisThread::sleep_for(50ms);
-                                Pipetadora_MoveTo(2, pontosColeta.pos[2]);
-                                ThisThread::sleep_for(50ms);
-                                Pipetadora_ActuateValve(1);
-                                for (int t=0; t<2000; t+=50) {
-                                    if (emergActive) break;
-                                    ThisThread::sleep_for(50ms);
-                                }
-                                Pipetadora_MoveTo(2, 0);
-                                ThisThread::sleep_for(50ms);
-                                // Dispensar
-                                Pipetadora_MoveLinear(pontosSolta[j].pos[0], pontosSolta[j].pos[1]);
-                                ThisThread::sleep_for(50ms);
-                                Pipetadora_MoveTo(2, pontosSolta[j].pos[2]);
-                                ThisThread::sleep_for(50ms);
-                                Pipetadora_ActuateValve(1);
-                                for (int t=0; t<1200; t+=50) {
-                                    if (emergActive) break;
-                                    ThisThread::sleep_for(50ms);
-                                }
-                                Pipetadora_MoveTo(2, 0);
-                                ThisThread::sleep_for(50ms);
-                                ++done;
-                            }
-                            if (emergActive) break;
-                        }
-                        if (emergActive) break;
-                        lcd.cls(); lcd.printf("Concluido");
-                        ThisThread::sleep_for(800ms);
-                        inSubmenu = false;
-                        cursor    = 0;
-                        drawMainMenu();
-                        break;
-                    }
-                }
-            }
+            menu.select();
         }
 
         ThisThread::sleep_for(50ms);
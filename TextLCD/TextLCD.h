@@ -22,6 +22,15 @@
  *               2015, v19: WH, Added 10x2D and 10x4D type for SSD1803 
  *               2015, v20: WH, Fixed occasional Init fail caused by insufficient wait time after ReturnHome command (0x02), Added defines to reduce memory footprint (eg LCD_ICON),
  *                              Fixed and Added more fonttable support for PCF2119R_3V3, Added HD66712 controller.
+ *               2025, v21: Added shadow framebuffer with dirty-cell flush (LCD_FRAMEBUF), setFrameBuffer() and flush() methods
+ *               2025, v22: Track the controller address counter, _putc() only sends an address command when auto-increment does not reach the next location
+ *               2025, v23: Queued non-blocking I2C transport for the PCF8574 expander (LCD_I2C_ASYNC), delays sent as padding frames
+ *               2025, v24: Added _writeString() bulk write, the PCF8574 expander packs a whole run of characters in one I2C burst
+ *               2025, v25: Optional busy flag polling on the RW pin of the PCF8574 expander (LCD_BUSY_FLAG), _waitReady() replaces the worst case delays
+ *               2025, v26: Optional background refresh thread that flushes the framebuffer at a fixed frame rate (LCD_REFRESH), setRefresh() method
+ *               2025, v27: printf() without Stream (LCD_PRINTF 0) formats integers, fixed-point and strings in a stack buffer and writes it with _puts()
+ *               2025, v28: UDC cache (LCD_UDC_CACHE) with getUDC(), putBar() and putIcon(), setUDC() takes a const bitpattern
+ *               2025, v29: Optional cycle counter scopes (LCD_PROFILE) on the queued I2C transport and the refresh thread frame write
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -142,22 +151,74 @@
 #define LCD_C_FT1      0x00001000  /*Font1, C            */
 #define LCD_C_FT2      0x00002000  /*Font2, R            */
 
+//Duration of one I2C expander frame on the bus in us (8 bits + ack at 100kHz)
+#define LCD_I2C_FRAME  90
+
+#if (LCD_I2C == 1) && (LCD_I2C_ASYNC == 1) && defined(DEVICE_I2C_ASYNCH) && (MCP23008 == 0)
+//Queued non-blocking transport for the PCF8574 expander
+#define LCD_I2C_QUEUED 1
+//Size of the expander frame queue, one I2C byte per frame (a full 20x4 screen is ~350 frames)
+#define LCD_I2C_QUEUE  512
+#else
+#define LCD_I2C_QUEUED 0
+#endif
+
+#if (LCD_I2C == 1) && (LCD_BUSY_FLAG == 1) && (MCP23008 == 0)
+//Busy flag polling through the RW pin of the PCF8574 expander
+#define LCD_I2C_BUSY   1
+//Duration of one busy flag read on the bus in us (2 + 3 frames written, 1 read, 3 address bytes at 100kHz)
+#define LCD_I2C_POLL   810
+#else
+#define LCD_I2C_BUSY   0
+#endif
+
+#if(LCD_FRAMEBUF == 1)
+//Shadow framebuffer size, fits the largest supported panel (40x4)
+#define LCD_FB_COLS    40
+#define LCD_FB_ROWS    4
+//Max number of unchanged cells rewritten to join two changed runs on a row.
+//Rewriting one cell costs the same bus traffic as the address command it saves.
+#define LCD_FB_GAP     1
+#endif
+
+#if (LCD_PRINTF != 1)
+//Stack buffer of printf(), fits the largest supported panel (40x4)
+#define LCD_PRINTF_BUF 160
+#endif
+
+/** Small printf formatter without heap or stdio, used by TextLCD_Base::printf() and TextLCD_Fixed::printf()
+ * Supports %d %i %u %x %X %c %s %% and %f, the '-' and '0' flags, width, precision and the 'l' length modifier.
+ *
+ * @param buf    Output buffer, not terminated
+ * @param size   Size of buf, the output is truncated at size characters
+ * @param format A printf-style format string
+ * @param args   The variables to use in formatting the string
+ * @return       The number of characters in buf
+ */
+int _lcd_vformat(char *buf, int size, const char *format, va_list args);
+
+#if (LCD_FRAMEBUF == 1) && (LCD_REFRESH == 1)
+//Background refresh of the framebuffer
+#define LCD_FB_REFRESH 1
+//Stack size of the refresh thread, holds a copy of the frame and the I2C burst buffer
+#define LCD_REFRESH_STACK 1536
+#else
+#define LCD_FB_REFRESH 0
+#endif
+
 /** A TextLCD interface for driving 4-bit HD44780-based LCDs
  *
  * @brief Currently supports 8x1, 8x2, 12x2, 12x3, 12x4, 16x1, 16x2, 16x3, 16x4, 20x2, 20x4, 24x2, 24x4, 40x2 and 40x4 panels
  *        Interface options include direct mbed pins, I2C portexpander (PCF8474/PCF8574A or MCP23008) or 
  *        SPI bus shiftregister (74595) or native I2C or SPI interfaces for some supported devices. 
  */
-class TextLCD_Base : public Stream {
-//class TextLCD_Base {    
-
 //Unfortunately the following #define selection breaks Doxygen !!!
-//Add it manually when you want to disable the Stream inheritance
-//#if (LCD_PRINTF == 1)
-//class TextLCD_Base : public Stream {
-//#else    
-//class TextLCD_Base {    
-//#endif
+//Generate the documentation with LCD_PRINTF 1
+#if (LCD_PRINTF == 1)
+class TextLCD_Base : public Stream {
+#else    
+class TextLCD_Base {    
+#endif
 
 public:
 
@@ -303,12 +364,15 @@ public:
      */
    int putc(int c);
 
-    /** Write a raw string to the LCD
+    /** Write a formatted string to the LCD
+     * Small formatter without heap or stdio: %d %i %u %x %X %c %s %% and %f (fixed-point rounded half up, default 6 decimals),
+     * with the '-' and '0' flags, width, precision and the 'l' length modifier.
+     * The text is formatted in a stack buffer of LCD_PRINTF_BUF characters and written with one bulk write per row.
      *
-     * @param string text, may be followed by variables to emulate formatting the string.
-     *                     However, printf formatting is NOT supported and variables will be ignored! 
+     * @param format A printf-style format string, followed by the
+     *               variables to use in formatting the string.
      */
-    int printf(const char* text, ...);
+    int printf(const char* format, ...);
 #else    
 #if DOXYGEN_ONLY
     /** Write a character to the LCD
@@ -388,7 +452,34 @@ public:
      * @param unsigned char c   The Index of the UDC (0..7) for HD44780 clones and (0..15) for some more advanced controllers
      * @param char *udc_data    The bitpatterns for the UDC (8 bytes of 5 significant bits for bitpattern and 3 bits for blinkmode (advanced types))       
      */
-    void setUDC(unsigned char c, char *udc_data);
+    void setUDC(unsigned char c, const char *udc_data);
+
+#if(LCD_UDC_CACHE == 1)
+    /** Get the UDC index that shows a bitpattern
+     * The bitpatterns are cached by address: CG RAM is only written when the pattern is not loaded yet,
+     * replacing the least recently used UDC. Indexes set by setUDC() are never replaced.
+     * Note that cells on screen that still show a replaced UDC change with it.
+     *
+     * @param char *udc_data    The bitpatterns for the UDC (8 bytes), must stay valid while cached
+     * @return                  The Index of the UDC (0..7), or ' ' when all indexes are set by setUDC()
+     */
+    int getUDC(const char *udc_data);
+
+    /** Write a horizontal bar graph at the cursor location
+     * Each cell shows 0..3 bars using the udc_2 (|), udc_3 (||) and udc_4 (|||) bitpatterns.
+     *
+     * @param int value   Current value (0..max)
+     * @param int max     Value of a full bar
+     * @param int width   Number of cells
+     */
+    void putBar(int value, int max, int width);
+
+    /** Write an icon at the cursor location, see getUDC()
+     *
+     * @param char *udc_data    The bitpatterns for the icon (8 bytes)
+     */
+    void putIcon(const char *udc_data);
+#endif
 
 #if(LCD_BLINK == 1)
     /** Set UDC Blink and Icon blink
@@ -469,6 +560,41 @@ public:
    void setInvert(bool invertOn);
 #endif
 
+#if(LCD_FRAMEBUF == 1)
+   /** Set Framebuffer mode
+     * When enabled, cls(), locate(), putc() and printf() only update a shadow framebuffer in RAM.
+     * The display is updated by flush(), which sends just the cells that differ from the display contents.
+     * Enabling the framebuffer clears the screen.
+     *
+     * @param bool on  Framebuffer on/off
+     * @return none
+     */
+   void setFrameBuffer(bool on);
+
+   /** Write the changed cells of the framebuffer to the display
+     * Consecutive changed cells on a row are written after a single address command,
+     * using the auto-increment of the controller's address counter.
+     *
+     * @param  none
+     * @return none
+     */
+   void flush();
+#endif
+
+#if(LCD_FB_REFRESH == 1)
+   /** Set Background refresh mode
+     * A low priority thread writes the framebuffer to the display fps times per second. While the refresh
+     * is running, flush() only hands the finished screen to the thread and returns, so drawing never waits
+     * for the LCD bus and screens completed within one frame are sent together. Only cls(), locate(), putc(),
+     * printf() and flush() may be used while the refresh is running; stop it before other calls that write
+     * to the LCD.
+     *
+     * @param int fps  Frames per second, 0 stops the refresh
+     * @return none
+     */
+   void setRefresh(int fps);
+#endif
+
 protected:
 
    /** LCD controller select, mainly used for LCD40x4
@@ -496,6 +622,13 @@ protected:
     virtual int _putc(int value);
     virtual int _getc();
 
+#if(LCD_PRINTF != 1)
+/** Write len characters at the cursor location
+  * Each part that is contiguous in the controller memory is sent with one _writeString().
+  */
+    void _puts(const char *text, int len);
+#endif
+
 /** Medium level initialisation method for LCD controller
   *  @param _LCDDatalength dl sets the datalength of data/commands
   *  @return none
@@ -525,7 +658,7 @@ protected:
   * @param unsigned char c   The Index of the UDC (0..7) for HD44780 clones and (0..15) for some more advanced controllers 
   * @param char *udc_data    The bitpatterns for the UDC (8 bytes of 5 significant bits)     
   */     
-    void _setUDC(unsigned char c, char *udc_data);   
+    void _setUDC(unsigned char c, const char *udc_data);   
 
 /** Low level method to restore the cursortype and display mode for current controller
   */     
@@ -570,6 +703,31 @@ protected:
   */
     virtual void _writeByte(int value);
 
+/** Low level bulk write of data bytes to LCD controller.
+  * Sets the memory address when needed and writes len characters, the address counter auto-increments.
+  * Bus interfaces may override this to send the whole run in one transfer.
+  *
+  * @param addr  The memoryaddress of the first character
+  * @param text  The characters to write
+  * @param len   Number of characters
+  */
+    virtual void _writeString(int addr, const char *text, int len);
+
+/** Low level wait for setup/hold and execution times of the LCD controller
+  * Default is a blocking wait, queued bus interfaces may delay the next writes instead.
+  */
+    virtual void _waitUs(int us);
+
+/** Low level wait for long operations of the LCD controller (init, clear screen)
+  * Default is a thread sleep.
+  */
+    virtual void _waitMs(int ms);
+
+/** Low level wait until the LCD controller has executed the last instruction, at most us microseconds
+  * Default is the worst case delay, bus interfaces that can read the controller poll the busy flag instead.
+  */
+    virtual void _waitReady(int us);
+
 //Display type
     LCDType _type;      // Display type 
     int _nr_cols;       
@@ -591,12 +749,51 @@ protected:
     int _row;
     LCDCursor _currentCursor; 
 
+// Controller DDRAM address counter as left by the last write, -1 when unknown
+    int _addr;
+
 // Function modes saved to allow switch between Instruction sets after initialisation time 
     int _function, _function_1, _function_x;
 
 // Icon, Booster mode and contrast saved to allow contrast change at later time
 // Only available for controllers with added features
     int _icon_power, _contrast;          
+
+#if(LCD_FRAMEBUF == 1)
+// Shadow framebuffer: _fb holds the requested screen, _fb_lcd what the display is showing
+    bool _fb_on;
+    char _fb[LCD_FB_ROWS][LCD_FB_COLS];
+    char _fb_lcd[LCD_FB_ROWS][LCD_FB_COLS];
+    int  _fb_dirty;     // Rows with pending changes, one bit per row
+
+/** Write the changed cells of a frame to the display, see flush()
+  *  @param fb_rows  Rows of the frame
+  *  @param dirty    Rows to compare with the display contents, one bit per row
+  */
+    void _flush(const char (*fb_rows)[LCD_FB_COLS], int dirty);
+#endif
+
+#if(LCD_UDC_CACHE == 1)
+// UDC cache: bitpattern loaded in each UDC index (NULL when unknown) and its last use
+    const char *_udc_cache[8];
+    uint32_t _udc_used[8];
+    uint32_t _udc_clock;
+    int  _udc_fixed;    // Indexes set by setUDC(), one bit per index
+#endif
+
+#if(LCD_FB_REFRESH == 1)
+/** Refresh thread: flush the framebuffer once per frame while the refresh is running
+  */
+    void _refreshLoop();
+
+// Background refresh
+    Thread _refresh_thread;
+    Mutex  _refresh_mutex;          // Held by the refresh thread while it writes the display
+    volatile int _refresh_ms;       // Frame period in ms, 0 when stopped
+    bool   _refresh_started;
+    char   _fb_frame[LCD_FB_ROWS][LCD_FB_COLS];  // Rows handed over by flush() for the next frame
+    int    _frame_dirty;                         // Rows handed over, one bit per row
+#endif
 };
 
 //--------- End TextLCD_Base -----------
@@ -725,12 +922,65 @@ private:
   */
     virtual void _writeByte(int value);   
 
+/** Place the 4 expander frames that write one byte (two nibbles, E high and low) in data
+  *  @param data  destination for the frames
+  *  @param value byte to write
+  *  @return number of frames (4)
+  */
+    int _packByte(char *data, int value);
+
+/** Bulk write to LCD serial bus expander
+  *  The address command, RS changes and all characters are packed in one burst of frames.
+  *  Each frame takes 9 bit times on the bus, longer than the setup/hold and execution times, so no waits are needed.
+  */
+    virtual void _writeString(int addr, const char *text, int len);
+
 /** Write data to MCP23008 I2C portexpander
   *  @param reg register to write
   *  @param value data to write
   *  @return none     
   */
     void _writeRegister (int reg, int value);     
+
+/** Write the databus shadowvalue to the portexpander
+  *  Queued when LCD_I2C_QUEUED, blocking otherwise
+  *  @param  none
+  *  @return none     
+  */
+    void _writeBus();
+
+#if(LCD_I2C_QUEUED == 1)
+/** Queued wait: append frames that repeat the current bus value (E low) for at least us microseconds
+  */
+    virtual void _waitUs(int us);
+
+/** Queued wait for long operations, same as _waitUs()
+  */
+    virtual void _waitMs(int ms);
+
+/** Append one frame to the queue, waits for room when the queue is full
+  */
+    void _queue(char value);
+
+/** Start a transfer of the queued frames when the bus is idle
+  */
+    void _submit();
+
+/** Transfer completion (interrupt context): release the sent frames and submit the next ones
+  */
+    void _done(int event);
+#endif
+
+#if(LCD_I2C_BUSY == 1)
+/** Wait for the controller by polling the busy flag, short instructions complete within the next frame
+  */
+    virtual void _waitReady(int us);
+
+/** Read the busy flag of the selected controller (RW high, D4..D7 released)
+  *  @return true when the controller is busy
+  */
+    bool _readBusy();
+#endif
   
 //I2C bus
     I2C *_i2c;
@@ -738,6 +988,15 @@ private:
     
 // Internal bus shadow value for serial bus only
     char _lcd_bus;      
+
+#if(LCD_I2C_QUEUED == 1)
+// Frame queue: written by the thread at _tx_tail, sent by the I2C interrupt from _tx_head
+    char _tx_buf[LCD_I2C_QUEUE];
+    volatile uint32_t _tx_head;
+    volatile uint32_t _tx_tail;
+    volatile uint32_t _tx_len;   // Frames in the transfer in flight, 0 when the bus is idle
+    EventFlags _tx_flags;        // Transfer completed
+#endif
 };
 #endif /* I2C Expander PCF8574/MCP23008 */
 
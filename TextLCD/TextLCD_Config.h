@@ -43,13 +43,21 @@
 
 //Select options to reduce memory footprint (multiple options allowed)
 #define LCD_UDC        1           /* Enable predefined UDC example*/
-#define LCD_PRINTF     1           /* Enable Stream implementation */
+#define LCD_PRINTF     0           /* Enable Stream implementation, 0 uses the small printf formatter without stdio */
 #define LCD_ICON       1           /* Enable Icon implementation -2.0K codesize*/
 #define LCD_ORIENT     1           /* Enable Orientation switch implementation -0.9K codesize*/
 #define LCD_BIGFONT    1           /* Enable Big Font implementation -0.6K codesize */
 #define LCD_INVERT     1           /* Enable display Invert implementation -0.5K codesize*/
 #define LCD_POWER      1           /* Enable Power control implementation -0.1K codesize*/
 #define LCD_BLINK      1           /* Enable UDC and Icon Blink control implementation -0.8K codesize*/
+#define LCD_FRAMEBUF   1           /* Enable shadow framebuffer with dirty-cell flush +0.3K RAM */
+#define LCD_I2C_ASYNC  1           /* Enable queued non-blocking transfers for I2C PCF8574 expander +0.3K RAM */
+#define LCD_BUSY_FLAG  1           /* Enable busy flag polling on the RW pin of the I2C PCF8574 expander instead of worst case delays */
+#define LCD_REFRESH    1           /* Enable background thread that flushes the framebuffer at a fixed frame rate +1.8K RAM */
+#define LCD_UDC_CACHE  1           /* Enable UDC cache with progress bar and icon methods +0.1K RAM */
+#ifndef LCD_PROFILE
+#define LCD_PROFILE    0           /* Enable cycle counter scopes on the I2C transport and refresh frame, needs the application Perfil.h (set from the build, eg -DLCD_PROFILE=1) */
+#endif
 
 //Select option to activate default fonttable or alternatively use conversion for specific controller versions (eg PCF2116C, PCF2119R)
 #define LCD_DEF_FONT   1
@@ -0,0 +1,452 @@
+/* mbed TextLCD Library, for LCDs based on HD44780 controllers
+ * Compile-time specialized driver for a single bus, panel geometry and controller.
+ * Copyright (c) 2025
+ *               2025, v01: Added TextLCD_Fixed (CRTP) and TextLCD_PCF8574 for HD44780 panels on a PCF8574 expander
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MBED_TEXTLCD_FIXED_H
+#define MBED_TEXTLCD_FIXED_H
+
+#include "mbed.h"
+#include "TextLCD.h"
+
+/** A compile-time specialized TextLCD for HD44780 panels
+ *
+ * Drop-in replacement for TextLCD_I2C when only one panel type is used. The bus is the derived class (CRTP):
+ * its methods are called without virtual dispatch and inlined. Panel size is a template parameter, so the
+ * address of a screen location is a constant expression. Only the HD44780 init sequence is compiled, there
+ * are no extended instruction sets, no second controller (LCD40x4) and no Stream.
+ *
+ * The Bus class must provide:
+ *   void _writeNibble(int value);                              4 bit write with RS low (init only)
+ *   void _write(int command, const char *text, int len);     optional command (command < 0: none) followed
+ *                                                              by len data bytes (len <= Cols), in one burst
+ *   void _setBL(bool value);                                   Backlight pin
+ *
+ * @code
+ * I2C i2c_lcd(D14, D15);
+ * TextLCD_PCF8574<20, 4> lcd(&i2c_lcd, 0x7E);
+ *
+ * lcd.printf("Hello World!\n");
+ * @endcode
+ */
+template <class Bus, int Cols, int Rows>
+class TextLCD_Fixed {
+public:
+    static_assert((Rows >= 1) && (Rows <= 4), "HD44780 panels have 1 to 4 rows");
+    static_assert((Cols >= 8) && (Cols <= 40), "HD44780 panels have 8 to 40 columns");
+    static_assert((Rows <= 2) || (Cols <= 20), "4 row panels wider than 20 columns need a second controller");
+    static_assert(LCD_DEF_FONT == 1, "Character translation (LCD_DEF_FONT 0) is only supported by TextLCD_Base");
+
+    /** Return the memoryaddress of screen column and row location (LCD_T_A addressing)
+     *
+     * @param column  The horizontal position from the left, indexed from 0
+     * @param row     The vertical position from the top, indexed from 0
+     * @return        The memoryaddress of screen column and row location
+     */
+    static constexpr int getAddress(int column, int row) {
+        return ((row & 1) ? 0x40 : 0x00) + ((row & 2) ? Cols : 0) + column;
+    }
+
+    /** Return the number of columns
+     */
+    static constexpr int columns() { return Cols; }
+
+    /** Return the number of rows
+     */
+    static constexpr int rows() { return Rows; }
+
+    /** Clear the screen and locate to 0,0
+     */
+    void cls() {
+#if(LCD_FRAMEBUF == 1)
+        if (_fb_on) {
+            memset(_fb, ' ', sizeof(_fb));
+            _fb_dirty = (1 << Rows) - 1;
+            _column = 0;
+            _row = 0;
+            return;
+        }
+#endif
+        _bus()._write(0x01, NULL, 0);  // cls, and set cursor to 0
+        thread_sleep_for(2);           // The CLS command takes 1.64 ms
+        _addr = 0;
+        _column = 0;
+        _row = 0;
+    }
+
+    /** Locate cursor to a screen column and row
+     *
+     * @param column  The horizontal position from the left, indexed from 0
+     * @param row     The vertical position from the top, indexed from 0
+     */
+    void locate(int column, int row) {
+        _column = (column < 0) ? 0 : ((column >= Cols) ? Cols - 1 : column);
+        _row    = (row < 0)    ? 0 : ((row >= Rows)    ? Rows - 1 : row);
+
+        // The address is sent with the next write, or now when the cursor is visible
+        _showCursor();
+    }
+
+    /** Write a character to the LCD
+     *
+     * @param c The character to write to the display
+     */
+    int putc(int c) {
+        char ch = c;
+        _puts(&ch, 1);
+        return c;
+    }
+
+    /** Write a formatted string to the LCD
+     * Uses the TextLCD formatter (_lcd_vformat), see TextLCD_Base::printf(). The text is formatted in
+     * a stack buffer of one screen, longer output is truncated.
+     *
+     * @param format A printf-style format string, followed by the
+     *               variables to use in formatting the string.
+     */
+    int printf(const char *format, ...) {
+        char text[Cols * Rows];
+        va_list args;
+
+        va_start(args, format);
+        int len = _lcd_vformat(text, sizeof(text), format, args);
+        va_end(args);
+
+        _puts(text, len);
+        return len;
+    }
+
+    /** Set the Cursormode
+     *
+     * @param cursorMode  The Cursor mode (CurOff_BlkOff, CurOn_BlkOff, CurOff_BlkOn, CurOn_BlkOn)
+     */
+    void setCursor(TextLCD_Base::LCDCursor cursorMode) {
+        _currentCursor = cursorMode;
+        _bus()._write(0x08 | TextLCD_Base::DispOn | cursorMode, NULL, 0);  // Display Ctrl 0000 1 D C B
+        _showCursor();
+    }
+
+    /** Set the Backlight mode
+     *
+     *  @param backlightMode The Backlight mode (LightOff, LightOn)
+     */
+    void setBacklight(TextLCD_Base::LCDBacklight backlightMode) {
+#if (BACKLIGHT_INV==0)
+        _bus()._setBL(backlightMode == TextLCD_Base::LightOn);
+#else
+        _bus()._setBL(backlightMode != TextLCD_Base::LightOn);
+#endif
+    }
+
+    /** Set User Defined Characters (UDC)
+     *
+     * @param unsigned char c   The Index of the UDC (0..7)
+     * @param char *udc_data    The bitpatterns for the UDC (8 bytes of 5 significant bits)
+     */
+    void setUDC(unsigned char c, const char *udc_data) {
+        _bus()._write(0x40 | ((c & 0x07) << 3), udc_data, 8);  // Set CG-RAM address and store pattern
+        _addr = -1;                                             // Address counter is in CG RAM now
+        _showCursor();
+    }
+
+#if(LCD_FRAMEBUF == 1)
+    /** Set Framebuffer mode, see TextLCD_Base::setFrameBuffer()
+     *
+     * @param bool on  Framebuffer on/off
+     */
+    void setFrameBuffer(bool on) {
+        if (on == _fb_on) return;
+
+        if (on) {
+            cls();
+            memset(_fb, ' ', sizeof(_fb));
+            memset(_fb_lcd, ' ', sizeof(_fb_lcd));
+            _fb_dirty = 0;
+            _fb_on = true;
+        }
+        else {
+            flush();
+            _fb_on = false;
+            _showCursor();
+        }
+    }
+
+    /** Write the changed cells of the framebuffer to the display, see TextLCD_Base::flush()
+     */
+    void flush() {
+        bool written = false;
+
+        if (!_fb_on) return;
+
+        for (int row = 0; row < Rows; row++) {
+            if (!(_fb_dirty & (1 << row))) continue;
+
+            const char *fb  = _fb[row];
+            char *lcd = _fb_lcd[row];
+            int col = 0;
+
+            while (col < Cols) {
+                if (fb[col] == lcd[col]) {
+                    col++;
+                    continue;
+                }
+
+                // Run up to the last changed cell, joining runs separated by at most LCD_FB_GAP unchanged cells
+                int start = col;
+                int end   = col + 1;
+                for (int c = col + 1; (c < Cols) && ((c - end) <= LCD_FB_GAP); c++) {
+                    if (fb[c] != lcd[c]) end = c + 1;
+                }
+
+                _writeString(getAddress(start, row), &fb[start], end - start);
+                memcpy(&lcd[start], &fb[start], end - start);
+                written = true;
+                col = end;
+            }
+        }
+        _fb_dirty = 0;
+
+        if (written) _showCursor();
+    }
+#endif
+
+protected:
+
+    TextLCD_Fixed() : _column(0), _row(0), _addr(-1), _currentCursor(TextLCD_Base::CurOn_BlkOff) {
+#if(LCD_FRAMEBUF == 1)
+        _fb_on = false;
+        _fb_dirty = 0;
+#endif
+    }
+
+/** HD44780 4 bit init, called by the Bus constructor once the bus is ready
+  */
+    void _init() {
+        thread_sleep_for(100);         // Wait 100ms to ensure powered up
+
+        // Controller may be in 8 bit mode or in 4 bit mode, see TextLCD_Base::_initCtrl()
+        _bus()._writeNibble(0x3);
+        thread_sleep_for(15);
+        _bus()._writeNibble(0x3);
+        thread_sleep_for(15);
+        _bus()._writeNibble(0x3);
+        thread_sleep_for(15);
+        _bus()._writeNibble(0x2);      // 4-bit mode, the next frames take longer than the 40us execution time
+
+        _bus()._write(0x20 | ((Rows > 1) ? 0x08 : 0x00), NULL, 0);  // Function set 001 DL=0 N F=0 - -
+        _bus()._write(0x02, NULL, 0);  // Cursor Home, DDRAM Address to Origin
+        thread_sleep_for(2);           // The Return Home command takes 1.64 ms
+        _bus()._write(0x06, NULL, 0);  // Entry Mode, I/D=1 (Cur incr), S=0 (No display shift)
+
+        setCursor(_currentCursor);     // Display On
+        cls();
+    }
+
+/** Write a string at the cursor location, wrapping at the end of a row
+  */
+    void _puts(const char *text, int len) {
+        while (len > 0) {
+            if (*text == '\n') {
+                _column = 0;
+                _row = (_row + 1) % Rows;
+                text++;
+                len--;
+                continue;
+            }
+
+            // Characters that fit on the current row
+            int n = 0;
+            while ((n < len) && (text[n] != '\n') && (_column + n < Cols)) n++;
+
+#if(LCD_FRAMEBUF == 1)
+            if (_fb_on) {
+                if (memcmp(&_fb[_row][_column], text, n) != 0) {
+                    memcpy(&_fb[_row][_column], text, n);
+                    _fb_dirty |= (1 << _row);
+                }
+            }
+            else
+#endif
+            _writeString(getAddress(_column, _row), text, n);
+
+            text += n;
+            len -= n;
+            _column += n;
+            if (_column >= Cols) {
+                _column = 0;
+                _row = (_row + 1) % Rows;
+            }
+        }
+
+        _showCursor();
+    }
+
+/** Write len data bytes at memoryaddress addr, with the address command only when needed
+  */
+    void _writeString(int addr, const char *text, int len) {
+        _bus()._write((addr != _addr) ? (0x80 | addr) : -1, text, len);
+        _addr = addr + len;
+    }
+
+/** Move the address counter to the cursor location when the cursor is visible
+  */
+    void _showCursor() {
+#if(LCD_FRAMEBUF == 1)
+        if (_fb_on) return;
+#endif
+        if (_currentCursor == TextLCD_Base::CurOff_BlkOff) return;
+
+        int addr = getAddress(_column, _row);
+        if (addr != _addr) {
+            _bus()._write(0x80 | addr, NULL, 0);
+            _addr = addr;
+        }
+    }
+
+    Bus& _bus() { return *static_cast<Bus*>(this); }
+
+// Cursor
+    int _column;
+    int _row;
+    int _addr;      // Controller DDRAM address counter, -1 when unknown
+    TextLCD_Base::LCDCursor _currentCursor;
+
+#if(LCD_FRAMEBUF == 1)
+// Shadow framebuffer, see TextLCD_Base
+    bool _fb_on;
+    char _fb[Rows][Cols];
+    char _fb_lcd[Rows][Cols];
+    int  _fb_dirty;
+#endif
+};
+
+
+#if(LCD_I2C == 1)
+/** HD44780 panel on a PCF8574 (or PCF8574A) I2C portexpander
+ *
+ * Uses the expander pin mapping selected in TextLCD_Config.h. Every write is packed in one blocking
+ * I2C::write: each frame takes 9 bit times on the bus, longer than the HD44780 setup/hold and
+ * execution times, so no waits are needed.
+ */
+template <int Cols, int Rows>
+class TextLCD_PCF8574 : public TextLCD_Fixed<TextLCD_PCF8574<Cols, Rows>, Cols, Rows> {
+    friend class TextLCD_Fixed<TextLCD_PCF8574<Cols, Rows>, Cols, Rows>;
+    static_assert(MCP23008 == 0, "TextLCD_PCF8574 supports the PCF8574 portexpander only");
+
+public:
+   /** Create a TextLCD interface using an I2C PCF8574 (or PCF8574A) portexpander
+     *
+     * @param i2c             I2C Bus
+     * @param deviceAddress   I2C slave address (default = PCF8574_SA0 = 0x40)
+     */
+    TextLCD_PCF8574(I2C *i2c, char deviceAddress = PCF8574_SA0) :
+                    _i2c(i2c), _slaveAddress(deviceAddress & 0xFE), _lcd_bus(LCD_BUS_I2C_DEF) {
+
+        // The max bitrate for PCF8574 is 100kbit
+        _i2c->frequency(100000);
+        _i2c->write(_slaveAddress, &_lcd_bus, 1);
+
+        this->_init();
+    }
+
+private:
+
+/** Expander pins for a 4 bit value, resolved at compile time for the selected module
+  */
+    static constexpr char _dataBits(int value) {
+        return ((value & 0x01) ? LCD_BUS_I2C_D4 : 0) |
+               ((value & 0x02) ? LCD_BUS_I2C_D5 : 0) |
+               ((value & 0x04) ? LCD_BUS_I2C_D6 : 0) |
+               ((value & 0x08) ? LCD_BUS_I2C_D7 : 0);
+    }
+
+/** Place the frames that write one byte (E high and low per nibble) in data
+  */
+    int _packByte(char *data, int value) {
+        char hi = (_lcd_bus & ~LCD_BUS_I2C_MSK) | _dataBits(value >> 4);
+        char lo = (_lcd_bus & ~LCD_BUS_I2C_MSK) | _dataBits(value);
+
+        data[0] = hi | LCD_BUS_I2C_E;
+        data[1] = hi;
+        data[2] = lo | LCD_BUS_I2C_E;
+        data[3] = lo;
+        _lcd_bus = lo;
+        return 4;
+    }
+
+/** Place a frame that changes RS in data, when needed
+  */
+    int _packRS(char *data, bool value) {
+        if (((_lcd_bus & LCD_BUS_I2C_RS) != 0) == value) return 0;
+
+        _lcd_bus ^= LCD_BUS_I2C_RS;
+        data[0] = _lcd_bus;
+        return 1;
+    }
+
+    void _writeNibble(int value) {
+        char data[3];
+        int n = _packRS(data, false);
+
+        _lcd_bus = (_lcd_bus & ~LCD_BUS_I2C_MSK) | _dataBits(value);
+        data[n++] = _lcd_bus | LCD_BUS_I2C_E;
+        data[n++] = _lcd_bus;
+        _i2c->write(_slaveAddress, data, n);
+    }
+
+    void _write(int command, const char *text, int len) {
+        char data[2 + 4 + (4 * Cols)];
+        int n = 0;
+
+        if (command >= 0) {
+            n += _packRS(&data[n], false);
+            n += _packByte(&data[n], command);
+        }
+        if (len > 0) {
+            n += _packRS(&data[n], true);
+            for (int i = 0; i < len; i++) {
+                n += _packByte(&data[n], text[i]);
+            }
+        }
+        if (n > 0) _i2c->write(_slaveAddress, data, n);
+    }
+
+    void _setBL(bool value) {
+        if (value) {
+            _lcd_bus |= LCD_BUS_I2C_BL;
+        }
+        else {
+            _lcd_bus &= ~LCD_BUS_I2C_BL;
+        }
+        _i2c->write(_slaveAddress, &_lcd_bus, 1);
+    }
+
+//I2C bus
+    I2C *_i2c;
+    char _slaveAddress;
+
+// Bus value of the last frame written
+    char _lcd_bus;
+};
+#endif
+
+#endif
@@ -0,0 +1,293 @@
+// bancada.cpp (host)
+// Bancada de vazão: roda protocolos canônicos pelo mesmo caminho do "Iniciar"
+// do main.cpp (comando PIPETAR para a thread de movimento) e imprime em JSON
+// poços por hora, percurso de cada eixo, ciclos do Z, acionamentos da válvula
+// e o tempo parado, para comparar versões do firmware. Cada ensaio começa com
+// um homing, que fica fora da medida. Com --passos (firmware compilado com
+// STEP_TRACE 1) cada ensaio também traz a análise das bordas de passo; com
+// --latencia fixa:variavel (us) cada ISR de timer entra atrasada.
+//
+//   simulador bancada [--passos] [--latencia F:V] [ensaio...]     (padrão: todos)
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "maquina.h"
+#include "passos.h"
+#include "Protocolo.h"
+#include "Pipetadora.h"
+
+using namespace std::chrono;
+using namespace std::chrono_literals;
+using sim::Tempo;
+
+static double seg(Tempo t) { return t.count() / 1e6; }
+
+//======================================================================
+// Ensaios
+//======================================================================
+
+// Reservatório e placa de 96 poços (8 linhas x 12 colunas, passo de 9 mm), em
+// unidades do firmware; colunas seguem X-, linhas seguem Y+
+static constexpr int32_t MM = 80;
+static const Ponto FONTE = { { -40 * MM, 40 * MM, -25 * MM } };
+
+static Ponto poco(int linha, int coluna) {
+    Ponto p = { { -(80 + 9 * coluna) * MM, (60 + 9 * linha) * MM, -20 * MM } };
+    return p;
+}
+
+// Um comando PIPETAR: uma coleta e seus pontos de solta
+struct Lote {
+    Ponto              coleta;
+    std::vector<Ponto> solta;
+    std::vector<int>   volume;
+};
+
+struct Ensaio {
+    const char* nome;
+    const char* descricao;
+    std::vector<Lote> (*montar)();
+};
+
+// Da fonte para os n primeiros poços (linha a linha), 1 mL cada
+static std::vector<Lote> distribuir(int n) {
+    Lote l;
+    l.coleta = FONTE;
+    for (int i = 0; i < n; ++i) {
+        l.solta.push_back(poco(i / 12, i % 12));
+        l.volume.push_back(1);
+    }
+    return { l };
+}
+
+// O PIPETAR tem uma única coleta: cada transferência da diluição é um comando
+static std::vector<Lote> diluir() {
+    std::vector<Lote> v;
+    for (int c = 0; c + 1 < 12; ++c) v.push_back({ poco(0, c), { poco(0, c + 1) }, { 1 } });
+    return v;
+}
+
+static const Ensaio ensaios[] = {
+    { "1x9",      "fonte -> A1..A9, 1 mL por poco (maximo do menu)", [] { return distribuir(9); } },
+    { "1x96",     "fonte -> placa de 96 pocos, 1 mL por poco",       [] { return distribuir(96); } },
+    { "diluicao", "diluicao seriada A1 -> A12, 1 mL por transferencia", diluir },
+};
+
+//======================================================================
+// Execução
+//======================================================================
+
+struct Resultado {
+    const Ensaio*         ensaio;
+    bool                  ok;
+    int                   pocos, ciclos;
+    long                  erradas;      // acionamentos fora da posição esperada (ou faltando/sobrando)
+    long                  alemDoFim;
+    maquina::Janela       janela;
+    std::vector<sim::Sono> sonos;       // sleep_for do firmware durante o ensaio
+    passos::Eixo          bordas[3];
+    long                  bordasPerdidas;
+};
+static std::vector<Resultado> resultados;
+
+// Captura das bordas do ensaio em curso (--passos), esvaziada a cada consulta
+static bool             comPassos = false;
+static passos::Captura  captura;
+
+static void drenarCaptura() {
+    if (!comPassos) return;
+    Pipetadora_Marca m[256];
+    uint32_t perdidas = 0;
+    int n;
+    while ((n = Pipetadora_TraceRead(m, 256, &perdidas)) > 0) captura.marcas.insert(captura.marcas.end(), m, m + n);
+    captura.perdidas += perdidas;
+}
+
+static bool executarComando(const Comando& c) {
+    while (!Protocolo_Send(c)) ThisThread::sleep_for(10ms);
+    Status s;
+    for (;;) {
+        drenarCaptura();
+        if (!Protocolo_Poll(s)) { ThisThread::sleep_for(10ms); continue; }
+        if (s.tipo == Status::FIM) return s.ok;
+    }
+}
+
+static std::map<std::pair<std::string, std::string>, sim::Sono> sonosPorLocal() {
+    std::map<std::pair<std::string, std::string>, sim::Sono> m;
+    for (const auto& s : sim::sonos()) m[std::make_pair(s.local, s.tarefa)] = s;
+    return m;
+}
+
+static bool mesmaPosicao(const maquina::Acionamento& a, const Ponto& p) {
+    for (int i = 0; i < 3; ++i) {
+        if (fabsf(a.mm[i] - p.pos[i] / maquina::U_POR_MM) > 0.1f) return false;
+    }
+    return true;
+}
+
+static void rodar(const Ensaio& e) {
+    std::vector<Lote> lotes = e.montar();
+    Resultado r;
+    r.ensaio = &e;
+    r.ciclos = 0;
+
+    // posições esperadas dos acionamentos: aspira na coleta, dispensa no poço
+    std::vector<Ponto> esperado, destinos;
+    for (const Lote& l : lotes) {
+        for (size_t k = 0; k < l.solta.size(); ++k) {
+            for (int v = 0; v < l.volume[k]; ++v) {
+                esperado.push_back(l.coleta);
+                esperado.push_back(l.solta[k]);
+                ++r.ciclos;
+            }
+            bool novo = true;
+            for (const Ponto& d : destinos) novo = novo && memcmp(&d, &l.solta[k], sizeof(Ponto)) != 0;
+            if (novo) destinos.push_back(l.solta[k]);
+        }
+    }
+    r.pocos = int(destinos.size());
+
+    Comando homing = { Comando::HOMING, nullptr, nullptr, nullptr, 0 };
+    r.ok = executarComando(homing);
+
+    auto antes = sonosPorLocal();
+    long fimAntes = 0;
+    for (const auto& x : maquina::eixos) fimAntes += x.alemDoFim;
+    if (comPassos) {
+        captura = passos::Captura();
+        Pipetadora_TraceStart(&captura.ref);
+    }
+    maquina::abrir();
+    for (size_t i = 0; r.ok && i < lotes.size(); ++i) {
+        const Lote& l = lotes[i];
+        Comando c = { Comando::PIPETAR, &l.coleta, l.solta.data(), l.volume.data(), int(l.solta.size()) };
+        r.ok = executarComando(c);
+    }
+    maquina::fechar();
+    drenarCaptura();
+    passos::analisar(captura, r.bordas);
+    r.bordasPerdidas = captura.perdidas;
+    r.janela = maquina::janela();
+    r.alemDoFim = -fimAntes;
+    for (const auto& x : maquina::eixos) r.alemDoFim += x.alemDoFim;
+
+    // o sleep_for da própria bancada (thread main) não é do firmware
+    for (auto& s : sonosPorLocal()) {
+        if (s.first.second == "main") continue;
+        sim::Sono d = s.second;
+        auto a = antes.find(s.first);
+        if (a != antes.end()) { d.vezes -= a->second.vezes; d.total -= a->second.total; }
+        if (d.vezes > 0) r.sonos.push_back(d);
+    }
+
+    const auto& ac = r.janela.acionamentos;
+    r.erradas = labs(long(ac.size()) - long(esperado.size()));
+    for (size_t i = 0; i < ac.size() && i < esperado.size(); ++i) {
+        if (!mesmaPosicao(ac[i], esperado[i])) ++r.erradas;
+    }
+    resultados.push_back(r);
+}
+
+//======================================================================
+// Saída JSON
+//======================================================================
+
+static void imprimir(const Resultado& r, bool ultimo) {
+    const maquina::Janela& j = r.janela;
+    double duracao = seg(j.duracao());
+    Tempo valvula{0};
+    for (const auto& a : j.acionamentos) valvula += a.duracao;
+    Tempo sono{0};
+    for (const auto& s : r.sonos) sono += s.total;
+
+    printf("    {\n");
+    printf("      \"nome\": \"%s\",\n", r.ensaio->nome);
+    printf("      \"descricao\": \"%s\",\n", r.ensaio->descricao);
+    printf("      \"ok\": %s,\n", r.ok && r.erradas == 0 && r.alemDoFim == 0 ? "true" : "false");
+    printf("      \"duracao_s\": %.3f,\n", duracao);
+    printf("      \"pocos\": %d,\n", r.pocos);
+    printf("      \"ciclos\": %d,\n", r.ciclos);
+    printf("      \"pocos_por_hora\": %.1f,\n", duracao > 0 ? r.pocos * 3600.0 / duracao : 0.0);
+    printf("      \"ciclos_por_hora\": %.1f,\n", duracao > 0 ? r.ciclos * 3600.0 / duracao : 0.0);
+    printf("      \"distancia_mm\": { \"x\": %.1f, \"y\": %.1f, \"z\": %.1f },\n",
+           j.percurso[0] / maquina::U_POR_MM, j.percurso[1] / maquina::U_POR_MM, j.percurso[2] / maquina::U_POR_MM);
+    printf("      \"ciclos_z\": %ld,\n", j.ciclosZ);
+    printf("      \"acionamentos_valvula\": %zu,\n", j.acionamentos.size());
+    printf("      \"valvula_s\": %.3f,\n", seg(valvula));
+    printf("      \"eixos_parados_s\": %.3f,\n", seg(j.duracao() - j.emMovimento));
+    printf("      \"sleep_for_s\": %.3f,\n", seg(sono));
+    printf("      \"sleep_for\": [");
+    for (size_t i = 0; i < r.sonos.size(); ++i) {
+        const sim::Sono& s = r.sonos[i];
+        printf("%s\n        { \"local\": \"%s\", \"thread\": \"%s\", \"vezes\": %ld, \"total_s\": %.3f }",
+               i ? "," : "", s.local.c_str(), s.tarefa.c_str(), s.vezes, seg(s.total));
+    }
+    printf("%s],\n", r.sonos.empty() ? "" : "\n      ");
+    printf("      \"posicoes_erradas\": %ld,\n", r.erradas);
+    printf("      \"passos_alem_do_fim\": %ld%s\n", r.alemDoFim, comPassos ? "," : "");
+    if (comPassos) {
+        printf("      \"bordas\": ");
+        passos::imprimir(r.bordas, r.bordasPerdidas, 6);
+        printf("\n");
+    }
+    printf("    }%s\n", ultimo ? "" : ",");
+}
+
+int bancada(int argc, char** argv) {
+    std::vector<const Ensaio*> escolhidos;
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--passos") == 0) {
+            Pipetadora_RefCaptura ref;
+            if (!Pipetadora_TraceStart(&ref)) {
+                fprintf(stderr, "--passos: firmware compilado sem STEP_TRACE (use -DSTEP_TRACE=1)\n");
+                return 5;
+            }
+            comPassos = true;
+            continue;
+        }
+        unsigned fixa, variavel;
+        if (strcmp(argv[i], "--latencia") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%u:%u", &fixa, &variavel) == 2) {
+            sim::latenciaIsr(Tempo(fixa), Tempo(variavel));
+            ++i;
+            continue;
+        }
+        const Ensaio* e = nullptr;
+        for (const Ensaio& x : ensaios) if (strcmp(x.nome, argv[i]) == 0) e = &x;
+        if (!e) {
+            fprintf(stderr, "ensaio desconhecido: %s (", argv[i]);
+            for (const Ensaio& x : ensaios) fprintf(stderr, " %s", x.nome);
+            fprintf(stderr, " )\n");
+            return 5;
+        }
+        escolhidos.push_back(e);
+    }
+    if (escolhidos.empty()) for (const Ensaio& x : ensaios) escolhidos.push_back(&x);
+
+    maquina::instalar(false);
+    sim::iniciar([escolhidos] {
+        Pipetadora_InitMotors();
+        Protocolo_Start();
+        for (const Ensaio* e : escolhidos) rodar(*e);
+        bool ok = true;
+        for (const Resultado& r : resultados) ok = ok && r.ok && r.erradas == 0 && r.alemDoFim == 0;
+        sim::terminar(ok ? 0 : 1);
+    });
+    auto inicio = steady_clock::now();
+    int codigo = sim::executar(hours(24));
+    double real = duration<double>(steady_clock::now() - inicio).count();
+
+    // tempo real só no stderr: o JSON é idêntico entre execuções da mesma versão
+    printf("{\n");
+    printf("  \"codigo\": %d,\n", codigo);
+    printf("  \"motivo\": \"%s\",\n", sim::motivo());
+    printf("  \"tempo_virtual_s\": %.3f,\n", seg(sim::agora()));
+    printf("  \"ensaios\": [\n");
+    for (size_t i = 0; i < resultados.size(); ++i) imprimir(resultados[i], i + 1 == resultados.size());
+    printf("  ]\n}\n");
+    fprintf(stderr, "%.3f s virtuais em %.2f s reais\n", seg(sim::agora()), real);
+    return codigo;
+}
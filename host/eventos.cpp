@@ -0,0 +1,214 @@
+// eventos.cpp (host)
+#include <cstring>
+#include <string>
+
+#include "eventos.h"
+
+namespace eventos {
+
+bool ler(FILE* f, Despejo& d) {
+    char linha[96];
+    bool cabecalho = false;
+    while (fgets(linha, sizeof(linha), f)) {
+        unsigned long a, b;
+        if (sscanf(linha, "#registro %lu %lu", &a, &b) == 2) {
+            if (a != sizeof(Registro_Evento)) return false;
+            d.total = b;
+            cabecalho = true;
+            continue;
+        }
+        if (sscanf(linha, "#perdidas %lu", &a) == 1) {
+            d.perdidas += long(a);
+            continue;
+        }
+        if (!cabecalho) continue;
+        uint8_t bytes[sizeof(Registro_Evento)];
+        size_t n = 0;
+        for (const char* p = linha; n < sizeof(bytes); p += 2, ++n) {
+            unsigned v;
+            if (sscanf(p, "%2x", &v) != 1) break;
+            bytes[n] = uint8_t(v);
+        }
+        if (n != sizeof(bytes)) continue;
+        Registro_Evento e;
+        memcpy(&e, bytes, sizeof(e));   // despejo e host são little-endian
+        d.eventos.push_back(e);
+    }
+    return cabecalho;
+}
+
+void capturar(Despejo& d) {
+    uint32_t cursor = Registro_Inicio();
+    uint32_t perdidas = 0;
+    Registro_Evento buf[64];
+    d.total = Registro_Total();
+    while (int32_t(d.total - cursor) > 0) {
+        int n = Registro_Ler(&cursor, buf, 64, &perdidas);
+        d.eventos.insert(d.eventos.end(), buf, buf + n);
+    }
+    d.perdidas += perdidas;
+}
+
+const char* nomeTipo(uint8_t tipo) {
+    switch (tipo) {
+    case REG_MOV_INICIO:  return "mov_inicio";
+    case REG_MOV_FIM:     return "mov_fim";
+    case REG_FIM_CURSO:   return "fim_de_curso";
+    case REG_VALVULA:     return "valvula";
+    case REG_EMERGENCIA:  return "emergencia";
+    case REG_FASE_INICIO: return "fase_inicio";
+    case REG_FASE_FIM:    return "fase_fim";
+    default:              return "?";
+    }
+}
+
+static const char* nomeFase(uint8_t fase) {
+    static const char* nomes[] = { "homing", "manual", "parar", "pipetar", "ciclo" };
+    return fase < sizeof(nomes) / sizeof(nomes[0]) ? nomes[fase] : "?";
+}
+
+static const char* nomeMotivo(uint8_t motivo) {
+    static const char* nomes[] = { "alvo", "fim_de_curso", "parada" };
+    return motivo < sizeof(nomes) / sizeof(nomes[0]) ? nomes[motivo] : "?";
+}
+
+static const char* nomeEixo(uint8_t eixo) {
+    static const char* nomes[] = { "X", "Y", "Z" };
+    return eixo < 3 ? nomes[eixo] : "";
+}
+
+static std::string detalhe(const Registro_Evento& e) {
+    switch (e.tipo) {
+    case REG_MOV_INICIO:
+        return (e.arg & REG_JOG) ? "jog" : (e.arg & REG_ESCRAVO) ? "escravo" : "";
+    case REG_MOV_FIM:     return nomeMotivo(e.arg);
+    case REG_FIM_CURSO:   return e.arg ? "tras" : "frente";
+    case REG_VALVULA:     return e.arg ? "solta" : "acionada";
+    case REG_EMERGENCIA:  return e.arg ? "apertada" : "solta";
+    case REG_FASE_INICIO:
+    case REG_FASE_FIM:    return nomeFase(e.arg);
+    default:              return "";
+    }
+}
+
+// Tempo em us a partir do us_ticker do primeiro evento; a diferença com sinal
+// absorve a volta dos 32 bits e eventos gravados fora de ordem por fontes concorrentes
+static std::vector<long long> tempos(const Despejo& d) {
+    std::vector<long long> t(d.eventos.size());
+    long long agora = d.eventos.empty() ? 0 : d.eventos[0].tempo;
+    for (size_t i = 0; i < d.eventos.size(); ++i) {
+        if (i > 0) agora += int32_t(d.eventos[i].tempo - d.eventos[i - 1].tempo);
+        t[i] = agora;
+    }
+    return t;
+}
+
+static bool temAlvo(const Registro_Evento& e) {
+    return e.b != REGISTRO_SEM_ALVO;
+}
+
+void csv(FILE* f, const Despejo& d) {
+    std::vector<long long> t = tempos(d);
+    fprintf(f, "t_us,evento,eixo,detalhe,a,b,erro\n");
+    for (size_t i = 0; i < d.eventos.size(); ++i) {
+        const Registro_Evento& e = d.eventos[i];
+        fprintf(f, "%lld,%s,%s,%s,%ld,", t[i], nomeTipo(e.tipo), nomeEixo(e.eixo), detalhe(e).c_str(), long(e.a));
+        bool mov = e.tipo == REG_MOV_INICIO || e.tipo == REG_MOV_FIM;
+        if (!mov || temAlvo(e)) fprintf(f, "%ld", long(e.b));
+        fprintf(f, ",");
+        if (e.tipo == REG_MOV_FIM && temAlvo(e)) fprintf(f, "%ld", long(e.a - e.b));
+        fprintf(f, "\n");
+    }
+}
+
+// Trilhos (tid): 1..3 eixos, 4 fases do protocolo, 5 válvula
+enum { TRILHO_PROTOCOLO = 4, TRILHO_VALVULA = 5, TRILHOS = 6 };
+
+void chrome(FILE* f, const Despejo& d) {
+    static const char* trilhos[TRILHOS] = { "", "X", "Y", "Z", "protocolo", "valvula" };
+    std::vector<long long> t = tempos(d);
+    // pares B/E por trilho: um E sem B (início sobrescrito) é descartado e um
+    // B sem E (evento ainda em curso) fecha no último instante
+    int abertos[TRILHOS] = {};
+    bool primeiro = true;
+    // começa o próximo objeto até o valor de "ph"
+    auto inicio = [&]() {
+        fprintf(f, "%s\n  {\"ph\":\"", primeiro ? "" : ",");
+        primeiro = false;
+    };
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (int tid = 1; tid < TRILHOS; ++tid) {
+        inicio();
+        fprintf(f, "M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", tid, trilhos[tid]);
+    }
+    for (size_t i = 0; i < d.eventos.size(); ++i) {
+        const Registro_Evento& e = d.eventos[i];
+        const long long ts = t[i];
+        const int eixo = (e.eixo < 3) ? e.eixo + 1 : 0;
+        switch (e.tipo) {
+        case REG_MOV_INICIO:
+            if (!eixo) break;
+            inicio();
+            fprintf(f, "B\",\"name\":\"%s\",\"ts\":%lld,\"pid\":1,\"tid\":%d,\"args\":{\"posicao\":%ld",
+                    (e.arg & REG_JOG) ? "jog" : "mov", ts, eixo, long(e.a));
+            if (temAlvo(e)) fprintf(f, ",\"alvo\":%ld", long(e.b));
+            fprintf(f, "}}");
+            ++abertos[eixo];
+            break;
+        case REG_MOV_FIM:
+            if (!eixo || abertos[eixo] == 0) break;
+            inicio();
+            fprintf(f, "E\",\"ts\":%lld,\"pid\":1,\"tid\":%d,\"args\":{\"motivo\":\"%s\",\"posicao\":%ld",
+                    ts, eixo, nomeMotivo(e.arg), long(e.a));
+            if (temAlvo(e)) fprintf(f, ",\"alvo\":%ld,\"erro\":%ld", long(e.b), long(e.a - e.b));
+            fprintf(f, "}}");
+            --abertos[eixo];
+            break;
+        case REG_FIM_CURSO:
+            inicio();
+            fprintf(f, "i\",\"s\":\"t\",\"name\":\"fim de curso\",\"ts\":%lld,\"pid\":1,\"tid\":%d,"
+                       "\"args\":{\"sentido\":\"%s\",\"posicao\":%ld}}", ts, eixo, detalhe(e).c_str(), long(e.a));
+            break;
+        case REG_VALVULA:
+            if (e.arg == 0) {
+                inicio();
+                fprintf(f, "B\",\"name\":\"acionada\",\"ts\":%lld,\"pid\":1,\"tid\":%d}", ts, TRILHO_VALVULA);
+                ++abertos[TRILHO_VALVULA];
+            } else if (abertos[TRILHO_VALVULA] > 0) {
+                inicio();
+                fprintf(f, "E\",\"ts\":%lld,\"pid\":1,\"tid\":%d}", ts, TRILHO_VALVULA);
+                --abertos[TRILHO_VALVULA];
+            }
+            break;
+        case REG_EMERGENCIA:
+            inicio();
+            fprintf(f, "i\",\"s\":\"g\",\"name\":\"emergencia %s\",\"ts\":%lld,\"pid\":1,\"tid\":%d}",
+                    detalhe(e).c_str(), ts, TRILHO_PROTOCOLO);
+            break;
+        case REG_FASE_INICIO:
+            inicio();
+            fprintf(f, "B\",\"name\":\"%s\",\"ts\":%lld,\"pid\":1,\"tid\":%d", nomeFase(e.arg), ts, TRILHO_PROTOCOLO);
+            if (e.arg == REG_CICLO) fprintf(f, ",\"args\":{\"ponto\":%ld,\"ciclo\":%ld}", long(e.a), long(e.b));
+            fprintf(f, "}");
+            ++abertos[TRILHO_PROTOCOLO];
+            break;
+        case REG_FASE_FIM:
+            if (abertos[TRILHO_PROTOCOLO] == 0) break;
+            inicio();
+            fprintf(f, "E\",\"ts\":%lld,\"pid\":1,\"tid\":%d,\"args\":{\"ok\":%s}}",
+                    ts, TRILHO_PROTOCOLO, e.a ? "true" : "false");
+            --abertos[TRILHO_PROTOCOLO];
+            break;
+        }
+    }
+    const long long fim = t.empty() ? 0 : t.back();
+    for (int tid = 1; tid < TRILHOS; ++tid) {
+        for (; abertos[tid] > 0; --abertos[tid]) {
+            inicio();
+            fprintf(f, "E\",\"ts\":%lld,\"pid\":1,\"tid\":%d}", fim, tid);
+        }
+    }
+    fprintf(f, "\n]}\n");
+}
+
+}
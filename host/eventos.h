@@ -0,0 +1,37 @@
+// eventos.h (host)
+// Decodificador do registro de eventos (Registro.h): lê o despejo de
+// Registro_Dump copiado do console da placa, ou o buffer do próprio firmware
+// no simulador, e escreve CSV ou JSON do formato de trace do Chrome
+// (chrome://tracing, Perfetto). O tempo de 32 bits do us_ticker é desdobrado
+// pela diferença entre eventos seguidos.
+#ifndef HOST_EVENTOS_H
+#define HOST_EVENTOS_H
+
+#include <cstdio>
+#include <vector>
+
+#include "Registro.h"
+
+namespace eventos {
+
+struct Despejo {
+    std::vector<Registro_Evento> eventos;
+    unsigned long                total = 0;      // gravados desde o boot
+    long                         perdidas = 0;   // sobrescritos durante a cópia
+};
+
+// Formato de Registro_Dump; false sem a linha #registro
+bool ler(FILE* f, Despejo& d);
+// Buffer atual do firmware (simulador)
+void capturar(Despejo& d);
+
+// t_us,evento,eixo,detalhe,a,b,erro
+void csv(FILE* f, const Despejo& d);
+// {"traceEvents":[...]}: um trilho por eixo, fases do protocolo e válvula
+void chrome(FILE* f, const Despejo& d);
+
+const char* nomeTipo(uint8_t tipo);
+
+}
+
+#endif // HOST_EVENTOS_H
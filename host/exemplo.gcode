@@ -0,0 +1,27 @@
+; Exemplo para o terminal serial (simulador gcode host/exemplo.gcode):
+; referencia, um ciclo de aspirar/dispensar e um contorno em XY com trechos
+; curtos encadeados pelo lookahead. mm em coordenadas de máquina (X negativo,
+; Z negativo para baixo a partir do topo).
+G28
+G90
+G0 X-40 Y40 Z-25        ; fonte
+M8                      ; aspira
+G4 P2000
+G0 X-80 Y60 Z-20        ; poço A1
+M8                      ; dispensa
+G4 P1200
+G0 X-100 Y100 Z0
+G1 X-120 Y100
+G1 X-125 Y101.3
+G1 X-128.7 Y105
+G1 X-130 Y110
+G1 X-130 Y130
+G1 X-128.7 Y135
+G1 X-125 Y138.7
+G1 X-120 Y140
+G1 X-100 Y140
+G91
+G1 X5 Y-5               ; relativo
+G90
+M400
+M114
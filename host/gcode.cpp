@@ -0,0 +1,322 @@
+// gcode.cpp (host)
+// Reprodução de um arquivo de comandos no terminal serial do firmware através
+// de um pseudo-terminal. Um remetente (thread do sistema, fora do tempo
+// virtual) abre o lado escravo do pty como um programa de envio abriria a
+// porta do ST-LINK e manda as linhas com controle de fluxo por contagem de
+// caracteres: no máximo TERMINAL_RX bytes de linhas sem resposta. O lado
+// mestre é a UART do console do firmware, um byte a cada 10 bits de tempo a
+// TERMINAL_BAUD. Os dois lados andam em passo: antes de cada byte o simulador
+// espera o remetente reagir a tudo que o firmware já transmitiu, então a
+// execução é idêntica entre rodadas.
+//
+// O main() do firmware roda inteiro (menu no LCD, botões parados); o envio
+// começa quando o menu principal aparece. Ao final imprime as respostas que
+// não são ok, os erros com a linha do arquivo, a vazão da serial, a espera
+// por cada ok e o tempo parado dos eixos durante o envio.
+//
+//   simulador gcode arquivo [limite_s] [--registro saida.csv|saida.json]
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <string>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+#include "maquina.h"   // depois de <thread>: mbed.h define a macro sleep_for
+#include "Terminal.h"
+
+#undef main
+
+using namespace std::chrono;
+using sim::Tempo;
+using maquina::U_POR_MM;
+
+static double seg(Tempo t) { return t.count() / 1e6; }
+
+//======================================================================
+// Remetente: o programa do outro lado da serial
+//======================================================================
+
+struct Remetente {
+    int                      porta = -1;   // lado escravo do pty
+    std::vector<std::string> linhas;       // sem comentários, com '\n'
+    std::vector<int>         numero;       // linha correspondente no arquivo
+    // passo com o simulador
+    std::atomic<uint64_t>    escritos{0};  // bytes escritos no pty
+    std::atomic<uint64_t>    recebidos{0}; // bytes lidos do pty
+    std::atomic<bool>        ocioso{false};// bloqueado à espera de resposta
+    std::atomic<bool>        fim{false};
+    // resultado, lido depois do fim
+    long                     oks = 0;
+    std::vector<std::pair<int, std::string>> erros;
+    size_t                   maxEmVoo = 0;
+};
+
+static Remetente rem;
+
+static void escreverTudo(int fd, const char* d, size_t n) {
+    while (n > 0) {
+        ssize_t k = ::write(fd, d, n);
+        if (k <= 0) return;
+        d += k;
+        n -= size_t(k);
+    }
+}
+
+static void remeter() {
+    std::deque<size_t> pendentes;   // linhas sem resposta, na ordem de envio
+    size_t proxima = 0, emVoo = 0;
+    std::string entrada;
+    for (;;) {
+        while (proxima < rem.linhas.size() && emVoo + rem.linhas[proxima].size() <= TERMINAL_RX) {
+            const std::string& l = rem.linhas[proxima];
+            escreverTudo(rem.porta, l.data(), l.size());
+            rem.escritos += l.size();
+            emVoo += l.size();
+            pendentes.push_back(proxima++);
+        }
+        rem.maxEmVoo = std::max(rem.maxEmVoo, emVoo);
+        if (pendentes.empty()) break;
+
+        char buf[256];
+        rem.ocioso = true;
+        ssize_t n = ::read(rem.porta, buf, sizeof(buf));
+        rem.ocioso = false;   // antes de recebidos: o simulador espera a reação
+        if (n <= 0) break;
+        rem.recebidos += uint64_t(n);
+        entrada.append(buf, size_t(n));
+        size_t p;
+        while ((p = entrada.find('\n')) != std::string::npos) {
+            std::string r = entrada.substr(0, p);
+            entrada.erase(0, p + 1);
+            if (!r.empty() && r.back() == '\r') r.pop_back();
+            bool ok = (r == "ok");
+            if (!ok && r.compare(0, 6, "error:") != 0) continue;   // M114, status
+            if (pendentes.empty()) continue;
+            size_t i = pendentes.front();
+            pendentes.pop_front();
+            emVoo -= rem.linhas[i].size();
+            if (ok) rem.oks++;
+            else    rem.erros.emplace_back(rem.numero[i], r);
+        }
+    }
+    rem.fim    = true;
+    rem.ocioso = true;
+}
+
+// Linhas do arquivo sem comentários de ';' e espaços nas pontas; vazias saem
+static bool carregar(const char* arquivo) {
+    FILE* f = fopen(arquivo, "r");
+    if (!f) {
+        fprintf(stderr, "%s: nao foi possivel abrir\n", arquivo);
+        return false;
+    }
+    char buf[512];
+    int numero = 0;
+    bool ok = true;
+    while (fgets(buf, sizeof(buf), f)) {
+        ++numero;
+        std::string l(buf);
+        size_t c = l.find(';');
+        if (c != std::string::npos) l.erase(c);
+        size_t a = l.find_first_not_of(" \t\r\n");
+        if (a == std::string::npos) continue;
+        l = l.substr(a, l.find_last_not_of(" \t\r\n") - a + 1) + "\n";
+        if (l.size() > TERMINAL_RX) {
+            fprintf(stderr, "%s:%d: linha maior que o buffer de recepcao (%d bytes)\n", arquivo, numero, TERMINAL_RX);
+            ok = false;
+        }
+        rem.linhas.push_back(l);
+        rem.numero.push_back(numero);
+    }
+    fclose(f);
+    return ok;
+}
+
+static bool abrirPty(int& mestre, int& escravo) {
+    mestre = posix_openpt(O_RDWR | O_NOCTTY);
+    if (mestre < 0 || grantpt(mestre) != 0 || unlockpt(mestre) != 0) return false;
+    const char* nome = ptsname(mestre);
+    if (!nome) return false;
+    escravo = open(nome, O_RDWR | O_NOCTTY);
+    if (escravo < 0) return false;
+    // modo bruto: sem eco, sem edição de linha, sem trocar '\n' por "\r\n"
+    termios t;
+    tcgetattr(escravo, &t);
+    cfmakeraw(&t);
+    tcsetattr(escravo, TCSANOW, &t);
+    fprintf(stderr, "pty %s\n", nome);
+    return true;
+}
+
+//======================================================================
+// Lado do simulador: o mestre do pty na UART do console
+//======================================================================
+
+static int      mestre = -1;
+static uint64_t lidos = 0, enviados = 0;
+static Tempo    tempoByte{87};
+static bool     rxAgendado = false;
+static Tempo    inicioEnvio{-1}, fimEnvio{0};
+
+// Espera de cada ok: do '\n' entregue à UART até o fim da resposta
+static std::deque<Tempo> chegadas;
+static long   respostas = 0;
+static Tempo  somaEspera{0}, maxEspera{0};
+static std::string linhaTx;
+
+// O remetente reagiu a tudo que o firmware transmitiu e ou deixou bytes no pty
+// ou está parado à espera de resposta: o próximo byte (ou a falta dele) não
+// depende mais do tempo real
+static void sincronizar() {
+    while (!(rem.recebidos.load() == enviados && (rem.ocioso.load() || rem.escritos.load() > lidos))) {
+        std::this_thread::yield();
+    }
+}
+
+static void rxByte();
+
+static void agendarRx() {
+    if (rxAgendado) return;
+    rxAgendado = true;
+    sim::agendar(sim::agora() + tempoByte, rxByte);
+}
+
+static void rxByte() {
+    rxAgendado = false;
+    sincronizar();
+    if (rem.escritos.load() > lidos) {
+        char c;
+        while (::read(mestre, &c, 1) != 1) {}
+        ++lidos;
+        if (c == '\n') chegadas.push_back(sim::agora());
+        sim::receberSerial(c);
+        agendarRx();
+    } else if (rem.fim.load()) {
+        fimEnvio = sim::agora();
+        maquina::fechar();
+        sim::terminar(rem.erros.empty() ? 0 : 1);
+    }
+}
+
+static void transmitido(const char* d, size_t n) {
+    escreverTudo(mestre, d, n);
+    enviados += n;
+    for (size_t i = 0; i < n; ++i) {
+        if (d[i] != '\n') { linhaTx += d[i]; continue; }
+        if (!linhaTx.empty() && linhaTx.back() == '\r') linhaTx.pop_back();
+        if (linhaTx == "ok" || linhaTx.compare(0, 6, "error:") == 0) {
+            if (!chegadas.empty()) {
+                Tempo espera = sim::agora() - chegadas.front();
+                chegadas.pop_front();
+                somaEspera += espera;
+                maxEspera = std::max(maxEspera, espera);
+            }
+            ++respostas;
+            if (linhaTx != "ok") printf("  %9.3f s  < %s\n", seg(sim::agora()), linhaTx.c_str());
+        } else {
+            printf("  %9.3f s  < %s\n", seg(sim::agora()), linhaTx.c_str());
+        }
+        linhaTx.clear();
+    }
+    agendarRx();
+}
+
+// O envio começa com o menu principal na tela (UART aberta e ISR ligada)
+static void esperarMenu() {
+    if (!sim::telaContem("Referenciamento")) {
+        sim::agendar(sim::agora() + milliseconds(10), esperarMenu);
+        return;
+    }
+    printf("  %9.3f s  menu principal: envio comeca\n", seg(sim::agora()));
+    inicioEnvio = sim::agora();
+    maquina::abrir();
+    agendarRx();
+}
+
+//======================================================================
+// Relatório
+//======================================================================
+
+static void relatorio(int codigo, const char* arquivo, double real) {
+    Tempo total = sim::agora();
+    printf("\n== Resultado: %s (codigo %d) em %.3f s virtuais, %.2f s reais (x%.0f) ==\n",
+           sim::motivo(), codigo, seg(total), real, real > 0 ? seg(total) / real : 0.0);
+
+    size_t bytes = 0;
+    for (const std::string& l : rem.linhas) bytes += l.size();
+    printf("\n== Terminal ==\n");
+    printf("  %s: %zu linhas, %zu bytes a %d baud\n", arquivo, rem.linhas.size(), bytes, sim::baudSerial());
+    printf("  respostas: %ld ok, %zu erros, %ld no total\n", rem.oks, rem.erros.size(), respostas);
+    for (const auto& e : rem.erros) printf("    linha %d: %s\n", e.first, e.second.c_str());
+    if (inicioEnvio >= Tempo(0) && fimEnvio > inicioEnvio) {
+        double d = seg(fimEnvio - inicioEnvio);
+        printf("  envio %.3f s: %.1f linhas/s, %.0f bytes/s (%.0f%% da serial)\n", d, rem.linhas.size() / d,
+               bytes / d, 100.0 * bytes / d / (sim::baudSerial() / 10.0));
+    }
+    printf("  bytes sem resposta: max %zu de %d\n", rem.maxEmVoo, TERMINAL_RX);
+    if (respostas > 0) {
+        printf("  espera pelo ok (fim da linha -> fim da resposta): media %.2f ms, max %.2f ms\n",
+               somaEspera.count() / 1e3 / respostas, maxEspera.count() / 1e3);
+    }
+    const maquina::Janela& j = maquina::janela();
+    if (j.duracao() > Tempo(0)) {
+        printf("  eixos em movimento %.3f s, parados %.3f s, %ld paradas de mais de 20 ms\n",
+               seg(j.emMovimento), seg(j.duracao() - j.emMovimento), j.pausas);
+        printf("  percurso X %.1f mm, Y %.1f mm, Z %.1f mm, %zu acionamentos da valvula\n",
+               j.percurso[0] / U_POR_MM, j.percurso[1] / U_POR_MM, j.percurso[2] / U_POR_MM, j.acionamentos.size());
+    }
+
+    printf("\n== Eixos ==\n");
+    for (const maquina::Eixo& e : maquina::eixos) {
+        printf("  %s  pos %7.1f mm  %ld passos  %ld alem do fim de curso\n",
+               e.nome, e.pos / U_POR_MM, e.passos, e.alemDoFim);
+    }
+
+    printf("\n== CPU ==\n");
+    printf("  ociosa %.3f s (%.1f%%)\n", seg(sim::ociosa()), 100.0 * seg(sim::ociosa()) / seg(total));
+    printf("  thread               prio  ocupada(s)  dormindo(s)  esperando(s)\n");
+    for (const auto& t : sim::tarefas()) {
+        printf("  %-20s %4d %11.3f %12.3f %13.3f\n", t.nome.c_str(), t.prioridade,
+               seg(t.ocupada), seg(t.dormindo), seg(t.esperando));
+    }
+}
+
+int gcode(int argc, char** argv, void (*gravarRegistro)(const char*)) {
+    if (argc < 1) {
+        fprintf(stderr, "uso: simulador gcode arquivo [limite_s] [--registro saida.csv|saida.json]\n");
+        return 5;
+    }
+    const char* arquivo = argv[0];
+    double limite = 900.0;
+    const char* saidaRegistro = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--registro") == 0 && i + 1 < argc) saidaRegistro = argv[++i];
+        else                                                    limite = atof(argv[i]);
+    }
+    if (!carregar(arquivo)) return 5;
+    int escravo;
+    if (!abrirPty(mestre, escravo)) {
+        perror("pty");
+        return 5;
+    }
+    rem.porta = escravo;
+    std::thread(remeter).detach();
+
+    tempoByte = Tempo((10 * 1000000 + TERMINAL_BAUD - 1) / TERMINAL_BAUD);
+    maquina::instalar(true);
+    sim::aoTransmitir(transmitido);
+    sim::agendar(Tempo(0), esperarMenu);
+
+    printf("== Linha do tempo ==\n");
+    sim::iniciar([] { app_main(); });
+    auto inicio = steady_clock::now();
+    int codigo = sim::executar(duration_cast<Tempo>(duration<double>(limite)));
+    double real = duration<double>(steady_clock::now() - inicio).count();
+
+    relatorio(codigo, arquivo, real);
+    if (saidaRegistro) gravarRegistro(saidaRegistro);
+    return codigo;
+}
@@ -0,0 +1,722 @@
+// hal.cpp (host)
+// Núcleo de tempo virtual, pinos, I2C e o modelo do LCD da HAL de host.
+//
+// Cada Thread do firmware é uma std::thread, mas só a que tem a vez roda; ela
+// passa a vez ao bloquear (sleep_for, flags, mutex) ou quando uma thread de
+// prioridade maior fica pronta. Sem thread pronta, o relógio salta para o
+// próximo prazo e os eventos de timer vencidos rodam como ISR.
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "sim.h"   // depois de <thread>: mbed.h define a macro sleep_for
+
+namespace sim {
+
+struct Tarefa {
+    enum Estado { PRONTA, RODANDO, DORMINDO, ESPERANDO, FIM };
+    std::string            nome;
+    int                    prioridade;
+    std::function<void()>  corpo;
+    Estado                 estado = PRONTA;
+    uint64_t               ordem  = 0;      // FIFO entre prioridades iguais
+    Tempo                  prazo{0};        // DORMINDO: despertar; ESPERANDO: timeout
+    std::function<bool()>  pronto;          // ESPERANDO
+    uint32_t               flags = 0;
+    EstatTarefa            estat;
+};
+
+struct Evento {
+    uint32_t              id;
+    std::function<void()> fn;
+};
+
+struct Pino {
+    int  nivel    = 0;
+    bool definido = false;
+    std::vector<std::pair<std::function<void()>, std::function<void()>>> bordas;
+};
+
+// Modelo HD44780 em modo 4 bits no PCF8574 (RS=bit0, RW=bit1, E=bit2, D4..D7=bits 4..7)
+struct Lcd {
+    int   colunas = 20, linhas = 4;
+    char  ddram[128];
+    int   ac = 0;
+    bool  cgram = false, quatroBits = false, meio = false;
+    int   alto = 0;
+    char  ultimo = 0;
+    Tempo ocupadoAte{0};
+    EstatLcd estat;
+
+    Lcd() { memset(ddram, ' ', sizeof(ddram)); }
+
+    void executar(bool rs, int v, Tempo t) {
+        if (rs) {
+            estat.dados++;
+            if (!cgram) ddram[ac & 0x7F] = char(v);
+            ac = (ac + 1) & 0x7F;
+            return;
+        }
+        if (v == 0x01)      { memset(ddram, ' ', sizeof(ddram)); ac = 0; cgram = false; ocupadoAte = t + Tempo(1520); }
+        else if (v >= 0x80) { ac = v & 0x7F; cgram = false; estat.enderecos++; }
+        else if (v >= 0x40) { cgram = true; }
+        else if (v >= 0x20) { quatroBits = !(v & 0x10); }
+        else if (v >= 0x02 && v < 0x04) { ac = 0; cgram = false; ocupadoAte = t + Tempo(1520); }
+    }
+
+    void quadro(char q, Tempo t) {
+        bool desce = (ultimo & 0x04) && !(q & 0x04);
+        ultimo = q;
+        if (!desce || (q & 0x02)) return;   // só escrita, na descida de E
+        int nibble = (q >> 4) & 0x0F;
+        bool rs = q & 0x01;
+        if (!quatroBits) {
+            // modo 8 bits da inicialização: cada pulso é um comando inteiro
+            executar(rs, nibble << 4, t);
+            meio = false;
+            return;
+        }
+        if (!meio) { alto = nibble; meio = true; }
+        else       { meio = false; executar(rs, (alto << 4) | nibble, t); }
+    }
+
+    std::string linha(int r) const {
+        int base = ((r & 1) ? 0x40 : 0x00) + ((r & 2) ? colunas : 0);
+        std::string s(ddram + base, colunas);
+        for (char& c : s) if ((unsigned char) c < 8) c = '#';
+        return s;
+    }
+};
+
+struct Nucleo {
+    std::mutex              trava;
+    std::condition_variable cv;
+    Tarefa*                 rodando   = nullptr;
+    bool                    terminado = false;
+    int                     codigo    = 0;
+    const char*             motivo    = "";
+    std::vector<Tarefa*>    tarefas;
+    uint64_t                contador  = 0;
+
+    Tempo                   relogio{0};
+    Tempo                   limite = Tempo::max();
+    Tempo                   ociosa{0};
+    int                     isr = 0;
+    Tempo                   latFixa{0}, latVariavel{0};   // entrada das ISR de timer
+    uint32_t                semente = 1;
+
+    std::multimap<std::pair<Tempo, uint64_t>, Evento> eventos;
+    std::unordered_map<uint32_t, std::multimap<std::pair<Tempo, uint64_t>, Evento>::iterator> porId;
+    uint32_t                proximoId = 1;
+    EstatTimer              timers;
+
+    std::map<int, Pino>     pinos;
+    std::vector<std::function<void(PinName, int)>> saidas;
+    std::vector<std::function<void(const PinName*, int, int)>> barramentos;
+
+    int                     baud = 0;
+    std::deque<char>        serialRx;
+    std::function<void()>   serialIsr;
+    std::vector<std::function<void(const char*, size_t)>> transmissores;
+
+    Lcd                     lcd;
+    EstatI2c                i2c;
+    Tempo                   barramentoLivre{0};
+
+    std::map<std::pair<std::string, std::string>, Sono> sonos;
+};
+
+// Estado único, criado no primeiro uso (os objetos globais do firmware usam a HAL na inicialização estática)
+static Nucleo& n() {
+    static Nucleo nucleo;
+    return nucleo;
+}
+
+static void terminarAqui(int codigo, const char* motivo);
+
+// ---------------- Escalonador ----------------
+
+static void dispararVencidos(Tempo ate) {
+    Nucleo& k = n();
+    while (!k.eventos.empty() && k.eventos.begin()->first.first <= ate) {
+        auto it = k.eventos.begin();
+        if (it->first.first > k.relogio) k.relogio = it->first.first;
+        if (k.latFixa.count() || k.latVariavel.count()) {
+            // gerador congruente: a mesma sequência de atrasos em toda execução
+            k.semente = k.semente * 1664525u + 1013904223u;
+            k.relogio += k.latFixa + Tempo(k.latVariavel.count() ? (k.semente >> 8) % (k.latVariavel.count() + 1) : 0);
+        }
+        Evento e = std::move(it->second);
+        k.porId.erase(e.id);
+        k.eventos.erase(it);
+        k.timers.disparos++;
+        ++k.isr;
+        e.fn();
+        --k.isr;
+    }
+}
+
+static void reavaliar() {
+    Nucleo& k = n();
+    for (Tarefa* t : k.tarefas) {
+        if (t->estado == Tarefa::DORMINDO && t->prazo <= k.relogio) {
+            t->estado = Tarefa::PRONTA;
+            t->ordem = ++k.contador;
+        } else if (t->estado == Tarefa::ESPERANDO && (t->prazo <= k.relogio || t->pronto())) {
+            t->estado = Tarefa::PRONTA;
+            t->ordem = ++k.contador;
+        }
+    }
+}
+
+static Tarefa* melhorPronta() {
+    Tarefa* m = nullptr;
+    for (Tarefa* t : n().tarefas) {
+        if (t->estado != Tarefa::PRONTA) continue;
+        if (!m || t->prioridade > m->prioridade || (t->prioridade == m->prioridade && t->ordem < m->ordem)) m = t;
+    }
+    return m;
+}
+
+// Próximo instante em que algo acontece sozinho: evento de timer ou prazo de thread
+static Tempo proximoPrazo(int acimaDe) {
+    Nucleo& k = n();
+    Tempo t = Tempo::max();
+    if (!k.eventos.empty()) t = k.eventos.begin()->first.first;
+    for (Tarefa* x : k.tarefas) {
+        if ((x->estado == Tarefa::DORMINDO || x->estado == Tarefa::ESPERANDO) && x->prioridade > acimaDe) {
+            t = std::min(t, x->prazo);
+        }
+    }
+    return t;
+}
+
+// Passa a vez para p e espera recebê-la de volta
+static void entregar(Tarefa* eu, Tarefa* p) {
+    Nucleo& k = n();
+    p->estado = Tarefa::RODANDO;
+    if (p == eu) return;
+    std::unique_lock<std::mutex> l(k.trava);
+    k.rodando = p;
+    k.cv.notify_all();
+    if (eu->estado == Tarefa::FIM) return;
+    k.cv.wait(l, [&] { return k.rodando == eu; });
+}
+
+// A thread atual já marcou seu estado (PRONTA, DORMINDO, ESPERANDO ou FIM): escolhe a próxima
+static void trocar() {
+    Nucleo& k = n();
+    Tarefa* eu = k.rodando;
+    for (;;) {
+        reavaliar();
+        Tarefa* p = melhorPronta();
+        if (p) {
+            entregar(eu, p);
+            return;
+        }
+        Tempo t = proximoPrazo(-1);
+        if (t == Tempo::max()) terminarAqui(2, "impasse: nenhuma thread pronta e nada agendado");
+        if (t > k.limite)      terminarAqui(3, "limite de tempo virtual");
+        if (t > k.relogio) {
+            k.ociosa += t - k.relogio;
+            k.relogio = t;
+        }
+        dispararVencidos(t);
+    }
+}
+
+Tempo agora()  { return n().relogio; }
+bool  emIsr()  { return n().isr > 0; }
+
+Tarefa* tarefaAtual()          { return n().rodando; }
+uint32_t& flagsTarefa(Tarefa* t) { return t->flags; }
+
+void preempcao() {
+    Nucleo& k = n();
+    if (k.isr || !k.rodando) return;
+    reavaliar();
+    Tarefa* p = melhorPronta();
+    if (p && p->prioridade > k.rodando->prioridade) {
+        k.rodando->estado = Tarefa::PRONTA;
+        k.rodando->ordem = ++k.contador;
+        trocar();
+    }
+}
+
+// Antes de executar() (construtores globais, como o do TextLCD) não há threads:
+// o relógio avança direto e os eventos vencidos rodam no caminho
+static void avancarSemThreads(Tempo fim) {
+    Nucleo& k = n();
+    dispararVencidos(fim);
+    if (fim > k.relogio) k.relogio = fim;
+}
+
+void ocupar(Tempo d) {
+    Nucleo& k = n();
+    if (!k.rodando) {
+        avancarSemThreads(k.relogio + d);
+        return;
+    }
+    if (k.isr) {
+        k.relogio += d;   // ISR não deveria esperar; só conta o tempo
+        return;
+    }
+    Tarefa* eu = k.rodando;
+    eu->estat.ocupada += d;
+    const Tempo fim = k.relogio + d;
+    for (;;) {
+        // ISR e threads de prioridade maior interrompem a espera ocupada
+        Tempo t = proximoPrazo(eu->prioridade);
+        if (t > fim) break;
+        if (t > k.limite) terminarAqui(3, "limite de tempo virtual");
+        if (t > k.relogio) k.relogio = t;
+        dispararVencidos(t);
+        preempcao();
+        if (k.relogio >= fim) return;
+    }
+    if (fim > k.limite) terminarAqui(3, "limite de tempo virtual");
+    if (fim > k.relogio) k.relogio = fim;
+}
+
+void dormir(Tempo d, const char* arquivo, int linha) {
+    Nucleo& k = n();
+    if (!k.rodando) {
+        avancarSemThreads(k.relogio + d);
+        return;
+    }
+    if (k.isr) {
+        error("sleep_for em ISR (%s:%d)", arquivo, linha);
+        return;
+    }
+    Tarefa* eu = k.rodando;
+    Tempo inicio = k.relogio;
+    eu->estado = Tarefa::DORMINDO;
+    eu->prazo  = k.relogio + (d > Tempo(0) ? d : Tempo(0));
+    trocar();
+
+    Tempo dormido = k.relogio - inicio;
+    eu->estat.dormindo += dormido;
+    const char* base = strrchr(arquivo, '/');
+    std::string local = std::string(base ? base + 1 : arquivo) + ":" + std::to_string(linha);
+    Sono& s = k.sonos[std::make_pair(local, eu->nome)];
+    s.local  = local;
+    s.tarefa = eu->nome;
+    s.vezes++;
+    s.total += dormido;
+}
+
+bool esperar(const std::function<bool()>& pronto, Tempo prazo) {
+    Nucleo& k = n();
+    if (pronto()) return true;
+    if (!k.rodando) {
+        while (!pronto()) {
+            if (k.eventos.empty() || k.eventos.begin()->first.first > prazo) return false;
+            avancarSemThreads(k.eventos.begin()->first.first);
+        }
+        return true;
+    }
+    if (k.isr) {
+        error("espera bloqueante em ISR");
+        return false;
+    }
+    Tarefa* eu = k.rodando;
+    Tempo inicio = k.relogio;
+    bool ok = true;
+    while (!pronto()) {
+        if (k.relogio >= prazo) { ok = false; break; }
+        eu->estado = Tarefa::ESPERANDO;
+        eu->prazo  = prazo;
+        eu->pronto = pronto;
+        trocar();
+        eu->pronto = nullptr;
+    }
+    eu->estat.esperando += k.relogio - inicio;
+    return ok;
+}
+
+uint32_t agendar(Tempo quando, std::function<void()> fn) {
+    Nucleo& k = n();
+    if (quando < k.relogio) quando = k.relogio;
+    uint32_t id = k.proximoId++;
+    auto it = k.eventos.emplace(std::make_pair(quando, ++k.contador), Evento{id, std::move(fn)});
+    k.porId[id] = it;
+    k.timers.agendados++;
+    return id;
+}
+
+void cancelar(uint32_t id) {
+    Nucleo& k = n();
+    auto it = k.porId.find(id);
+    if (it == k.porId.end()) return;
+    k.eventos.erase(it->second);
+    k.porId.erase(it);
+    k.timers.cancelados++;
+}
+
+Tarefa* criarTarefa(int prioridade, const char* nome, std::function<void()> corpo) {
+    Nucleo& k = n();
+    Tarefa* t = new Tarefa;
+    t->nome        = nome;
+    t->prioridade  = prioridade;
+    t->corpo       = std::move(corpo);
+    t->ordem       = ++k.contador;
+    t->estat.nome  = nome;
+    t->estat.prioridade = prioridade;
+    k.tarefas.push_back(t);
+
+    std::thread([t] {
+        Nucleo& k = n();
+        {
+            std::unique_lock<std::mutex> l(k.trava);
+            k.cv.wait(l, [&] { return k.rodando == t; });
+        }
+        t->corpo();
+        t->estado = Tarefa::FIM;
+        trocar();
+    }).detach();
+
+    preempcao();
+    return t;
+}
+
+// ---------------- Execução ----------------
+
+static void terminarAqui(int codigo, const char* motivo) {
+    Nucleo& k = n();
+    std::unique_lock<std::mutex> l(k.trava);
+    if (!k.terminado) {
+        k.terminado = true;
+        k.codigo    = codigo;
+        k.motivo    = motivo;
+    }
+    k.rodando = nullptr;
+    k.cv.notify_all();
+    // a thread simulada que terminou a execução fica parada aqui
+    k.cv.wait(l, [] { return false; });
+}
+
+void terminar(int codigo) { terminarAqui(codigo, "fim do cenário"); }
+
+const char* motivo() { return n().motivo; }
+
+void latenciaIsr(Tempo fixa, Tempo variavel) {
+    n().latFixa     = fixa;
+    n().latVariavel = variavel;
+}
+
+void iniciar(std::function<void()> corpo) {
+    criarTarefa(osPriorityNormal, "main", std::move(corpo));
+}
+
+int executar(Tempo limite) {
+    Nucleo& k = n();
+    k.limite = limite;
+    std::unique_lock<std::mutex> l(k.trava);
+    k.rodando = melhorPronta();
+    if (!k.rodando) return 2;
+    k.rodando->estado = Tarefa::RODANDO;
+    k.cv.notify_all();
+    k.cv.wait(l, [&] { return k.terminado; });
+    return k.codigo;
+}
+
+Tempo ociosa() { return n().ociosa; }
+
+const EstatTimer& timers() { return n().timers; }
+
+std::vector<EstatTarefa> tarefas() {
+    std::vector<EstatTarefa> v;
+    for (Tarefa* t : n().tarefas) v.push_back(t->estat);
+    return v;
+}
+
+std::vector<Sono> sonos() {
+    std::vector<Sono> v;
+    for (auto& s : n().sonos) v.push_back(s.second);
+    std::sort(v.begin(), v.end(), [](const Sono& a, const Sono& b) { return a.total > b.total; });
+    return v;
+}
+
+// ---------------- Pinos ----------------
+
+void registrarEntrada(PinName p, PinMode m) {
+    Pino& x = n().pinos[p];
+    if (x.definido) return;
+    x.nivel    = (m == PullUp) ? 1 : 0;
+    x.definido = true;
+}
+
+int nivel(PinName p) {
+    return n().pinos[p].nivel;
+}
+
+void escrever(PinName p, int v) {
+    Nucleo& k = n();
+    k.pinos[p].nivel = v;
+    for (auto& f : k.saidas) f(p, v);
+}
+
+void escreverBarramento(const PinName* p, int quantos, int v) {
+    Nucleo& k = n();
+    for (int i = 0; i < quantos; ++i) k.pinos[p[i]].nivel = (v >> i) & 1;
+    for (auto& f : k.barramentos) f(p, quantos, v);
+}
+
+void registrarBorda(PinName p, std::function<void()> subida, std::function<void()> descida) {
+    n().pinos[p].bordas.emplace_back(std::move(subida), std::move(descida));
+}
+
+void aoEscrever(std::function<void(PinName, int)> f)                       { n().saidas.push_back(std::move(f)); }
+void aoEscreverBarramento(std::function<void(const PinName*, int, int)> f) { n().barramentos.push_back(std::move(f)); }
+
+void definirEntrada(PinName p, int v) {
+    Nucleo& k = n();
+    Pino& x = k.pinos[p];
+    x.definido = true;
+    v = v ? 1 : 0;
+    if (x.nivel == v) return;
+    x.nivel = v;
+    ++k.isr;
+    for (auto& b : x.bordas) {
+        if (v && b.first)   b.first();
+        if (!v && b.second) b.second();
+    }
+    --k.isr;
+}
+
+// ---------------- Serial ----------------
+
+void serialAbrir(int baud)                  { n().baud = baud; }
+void serialIsr(std::function<void()> f)     { n().serialIsr = std::move(f); }
+int  baudSerial()                           { return n().baud; }
+void aoTransmitir(std::function<void(const char*, size_t)> f) { n().transmissores.push_back(std::move(f)); }
+
+int serialLer(char* c) {
+    Nucleo& k = n();
+    if (k.serialRx.empty()) return 0;
+    *c = k.serialRx.front();
+    k.serialRx.pop_front();
+    return 1;
+}
+
+void receberSerial(char c) {
+    Nucleo& k = n();
+    k.serialRx.push_back(c);
+    ++k.isr;
+    if (k.serialIsr) k.serialIsr();
+    --k.isr;
+}
+
+// 10 bits por byte (start, 8 dados, stop); sem destino, os bytes se perdem
+void serialEnviar(const char* d, size_t quantos) {
+    Nucleo& k = n();
+    if (k.baud > 0) ocupar(Tempo((int64_t(quantos) * 10 * 1000000 + k.baud - 1) / k.baud));
+    for (auto& f : k.transmissores) f(d, quantos);
+}
+
+// ---------------- LCD ----------------
+
+void configurarLcd(int colunas, int linhas) {
+    n().lcd.colunas = colunas;
+    n().lcd.linhas  = linhas;
+}
+
+std::string linhaLcd(int linha) { return n().lcd.linha(linha); }
+
+bool telaContem(const char* texto) {
+    for (int r = 0; r < n().lcd.linhas; ++r) {
+        if (linhaLcd(r).find(texto) != std::string::npos) return true;
+    }
+    return false;
+}
+
+const EstatI2c& i2c() { return n().i2c; }
+
+const EstatLcd& lcd() { return n().lcd.estat; }
+
+// Duração de uma transação: endereço + n bytes, 9 bits cada
+static Tempo duracaoI2c(int bytes, int hz) {
+    return Tempo((int64_t(bytes + 1) * 9 * 1000000 + hz - 1) / hz);
+}
+
+static void registrarI2c(const char* dados, int quantos, Tempo duracao) {
+    Nucleo& k = n();
+    k.i2c.transacoes++;
+    k.i2c.bytes   += quantos + 1;
+    k.i2c.ocupado += duracao;
+    for (int i = 0; i < quantos; ++i) k.lcd.quadro(dados[i], k.relogio);
+}
+
+// Espera ocupada até o fim de uma transferência assíncrona em curso
+static void esperarBarramento() {
+    Nucleo& k = n();
+    if (k.barramentoLivre > k.relogio) ocupar(k.barramentoLivre - k.relogio);
+}
+
+} // namespace sim
+
+// ---------------- Classes da HAL ----------------
+
+namespace mbed {
+
+InterruptIn::InterruptIn(PinName pin, PinMode modo) : _pin(pin) {
+    sim::registrarEntrada(pin, modo);
+    sim::registrarBorda(pin,
+                        [this] { if (_habilitado && _subida) _subida(); },
+                        [this] { if (_habilitado && _descida) _descida(); });
+}
+
+void TimerEvent::insert_absolute(TickerDataClock::time_point quando) {
+    remove();
+    _evento = sim::agendar(quando.time_since_epoch(), [this] { _evento = 0; handler(); });
+}
+
+int I2C::write(int endereco, const char* dados, int n, bool repetido) {
+    (void) endereco; (void) repetido;
+    sim::esperarBarramento();
+    sim::Tempo d = sim::duracaoI2c(n, _hz);
+    sim::ocupar(d);
+    sim::registrarI2c(dados, n, d);
+    return 0;
+}
+
+int I2C::read(int endereco, char* dados, int n, bool repetido) {
+    (void) endereco; (void) repetido;
+    sim::esperarBarramento();
+    sim::Tempo d = sim::duracaoI2c(n, _hz);
+    sim::ocupar(d);
+    sim::registrarI2c(nullptr, 0, d);
+    sim::Nucleo& k = sim::n();
+    // D7 (bit 7) é o busy flag enquanto o controlador executa cls/home
+    char estado = (k.lcd.ultimo & 0x0F) | ((k.relogio < k.lcd.ocupadoAte) ? 0x80 : 0x00);
+    for (int i = 0; i < n; ++i) dados[i] = estado;
+    return 0;
+}
+
+int I2C::transfer(int endereco, const char* tx, int ntx, char* rx, int nrx,
+                  const event_callback_t& cb, int eventos, bool repetido) {
+    (void) endereco; (void) rx; (void) nrx; (void) eventos; (void) repetido;
+    sim::Nucleo& k = sim::n();
+    if (k.barramentoLivre > k.relogio) return -1;   // transferência anterior em curso
+    sim::Tempo d = sim::duracaoI2c(ntx, _hz);
+    k.barramentoLivre = k.relogio + d;
+    std::string copia(tx, ntx);
+    event_callback_t aviso = cb;
+    sim::agendar(k.barramentoLivre, [copia, d, aviso] {
+        sim::registrarI2c(copia.data(), int(copia.size()), d);
+        if (aviso) aviso(I2C_EVENT_TRANSFER_COMPLETE);
+    });
+    return 0;
+}
+
+int EventQueue::post(Callback<void()> f) {
+    static bool despachando = false;
+    _fila.push_back(f);
+    if (!despachando) {
+        despachando = true;
+        sim::criarTarefa(osPriorityNormal, "shared_event_queue", [this] { dispatch_forever(); });
+    } else if (!sim::emIsr()) {
+        sim::preempcao();
+    }
+    return 1;
+}
+
+void EventQueue::dispatch_forever() {
+    for (;;) {
+        sim::esperar([this] { return !_fila.empty(); }, sim::Tempo::max());
+        Callback<void()> f = _fila.front();
+        _fila.erase(_fila.begin());
+        f();
+    }
+}
+
+EventQueue* mbed_event_queue() {
+    static EventQueue fila;
+    return &fila;
+}
+
+} // namespace mbed
+
+namespace rtos {
+
+uint32_t Thread::flags_set(uint32_t f) {
+    if (!_tarefa) return osFlagsError;
+    uint32_t& flags = sim::flagsTarefa(_tarefa);
+    flags |= f;
+    uint32_t r = flags;
+    if (!sim::emIsr()) sim::preempcao();
+    return r;
+}
+
+void Mutex::lock() {
+    sim::Tarefa* eu = sim::tarefaAtual();
+    sim::esperar([this, eu] { return _dono == nullptr || _dono == eu; }, sim::Tempo::max());
+    _dono = eu;
+    ++_contagem;
+}
+
+bool Mutex::trylock() {
+    sim::Tarefa* eu = sim::tarefaAtual();
+    if (_dono && _dono != eu) return false;
+    _dono = eu;
+    ++_contagem;
+    return true;
+}
+
+void Mutex::unlock() {
+    if (--_contagem > 0) return;
+    _dono = nullptr;
+    sim::preempcao();
+}
+
+uint32_t EventFlags::esperar(uint32_t f, bool todos, uint32_t timeout, bool limpar) {
+    auto pronto = [this, f, todos] { return todos ? (_flags & f) == f : (_flags & f) != 0; };
+    sim::Tempo prazo = (timeout == osWaitForever) ? sim::Tempo::max()
+                                                  : sim::agora() + std::chrono::milliseconds(timeout);
+    if (!pronto() && (timeout == 0 || !sim::esperar(pronto, prazo))) return osFlagsErrorTimeout;
+    uint32_t r = _flags;
+    if (limpar) _flags &= ~f;
+    return r;
+}
+
+namespace ThisThread {
+
+static uint32_t esperarFlags(uint32_t f, bool todos, bool limpar) {
+    sim::Tarefa* eu = sim::tarefaAtual();
+    uint32_t& flags = sim::flagsTarefa(eu);
+    sim::esperar([&flags, f, todos] { return todos ? (flags & f) == f : (flags & f) != 0; }, sim::Tempo::max());
+    uint32_t r = flags;
+    if (limpar) flags &= ~f;
+    return r;
+}
+
+uint32_t flags_wait_any(uint32_t f, bool limpar) { return esperarFlags(f, false, limpar); }
+uint32_t flags_wait_all(uint32_t f, bool limpar) { return esperarFlags(f, true, limpar); }
+
+uint32_t flags_clear(uint32_t f) {
+    uint32_t& flags = sim::flagsTarefa(sim::tarefaAtual());
+    uint32_t r = flags;
+    flags &= ~f;
+    return r;
+}
+
+} // namespace ThisThread
+} // namespace rtos
+
+void error(const char* formato, ...) {
+    va_list a;
+    va_start(a, formato);
+    fprintf(stderr, "error: ");
+    vfprintf(stderr, formato, a);
+    fprintf(stderr, "\n");
+    va_end(a);
+    sim::terminarAqui(4, "error()");
+}
+
+uint32_t       SystemCoreClock = 180000000;
+DWT_Type       dwtHost;
+CoreDebug_Type coreDebugHost;
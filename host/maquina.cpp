@@ -0,0 +1,138 @@
+// maquina.cpp (host)
+#include <cstdio>
+#include <cstdlib>
+
+#include "maquina.h"
+#include "pinos.h"
+
+using namespace std::chrono;
+
+namespace maquina {
+
+// Cursos: o zero de cada eixo é o fim de curso do homing (X e Z no topo do curso, Y na base)
+Eixo eixos[3] = {
+    { "X", -3000, -24000,    0, FDC_XDWN, FDC_XUP },
+    { "Y",  2500,      0, 24000, FDC_YDWN, FDC_YUP },
+    { "Z", -1200,  -8000,    0, FDC_ZDWN, FDC_ZUP },
+};
+
+static int  habilitado[2] = { 0, 0 };   // EN ativo em nível baixo
+static int  direcao[2]    = { 0, 0 };
+static int  anguloZ       = -1;         // meio passo elétrico das bobinas (0..7), -1 → solto
+static int  sentidoZ      = 0;          // sinal do último passo do Z
+static long saltos        = 0;
+static bool eco           = false;
+
+static Janela j;
+static Tempo  ultimoPasso{-1};
+static Tempo  inicioPulso{-1};
+
+const Janela& janela() { return j; }
+long saltosZ() { return saltos; }
+
+void abrir() {
+    j = Janela();
+    j.aberta = true;
+    j.inicio = sim::agora();
+    ultimoPasso = Tempo(-1);
+}
+
+void fechar() {
+    j.aberta = false;
+    j.fim = sim::agora();
+}
+
+static void atualizarFins(Eixo& e) {
+    sim::definirEntrada(e.fimMin, e.pos <= e.minimo);
+    sim::definirEntrada(e.fimMax, e.pos >= e.maximo);
+}
+
+static void mover(int id, int delta) {
+    Eixo& e = eixos[id];
+    e.pos += delta;
+    e.passos++;
+    if (e.pos < e.minimo - 80 || e.pos > e.maximo + 80) e.alemDoFim++;   // mais de 1 mm além do fim
+    atualizarFins(e);
+
+    int sentido = delta > 0 ? 1 : -1;
+    if (!j.aberta) {
+        if (id == 2) sentidoZ = sentido;
+        return;
+    }
+    j.percurso[id] += abs(delta);
+    if (id == 2) {
+        if (sentidoZ < 0 && sentido > 0) j.ciclosZ++;
+        sentidoZ = sentido;
+    }
+    Tempo t = sim::agora();
+    if (ultimoPasso >= Tempo(0)) {
+        if (t - ultimoPasso <= milliseconds(20)) j.emMovimento += t - ultimoPasso;
+        else                                     j.pausas++;
+    }
+    ultimoPasso = t;
+}
+
+// Padrão das bobinas → meio passo elétrico (SEQ_Z_MEIO do firmware)
+static int anguloBobinas(int padrao) {
+    static const uint8_t seq[8] = { 0b0001, 0b0011, 0b0010, 0b0110, 0b0100, 0b1100, 0b1000, 0b1001 };
+    for (int i = 0; i < 8; ++i) if (seq[i] == padrao) return i;
+    return -1;
+}
+
+static void valvula(int v) {
+    Tempo t = sim::agora();
+    if (!v) {
+        inicioPulso = t;
+        return;
+    }
+    if (inicioPulso < Tempo(0)) return;
+    Acionamento a;
+    a.inicio  = inicioPulso;
+    a.duracao = t - inicioPulso;
+    for (int i = 0; i < 3; ++i) a.mm[i] = eixos[i].pos / U_POR_MM;
+    inicioPulso = Tempo(-1);
+    if (!j.aberta) return;
+    j.acionamentos.push_back(a);
+    if (eco) {
+        printf("  %9.3f s  valvula %3d ms em X%7.1f Y%7.1f Z%7.1f mm\n",
+               a.inicio.count() / 1e6, int(a.duracao.count() / 1000), a.mm[0], a.mm[1], a.mm[2]);
+    }
+}
+
+static void saida(PinName p, int v) {
+    const PinName step[2] = { MOTOR_X, MOTOR_Y };
+    const PinName dir[2]  = { DIR_X, DIR_Y };
+    const PinName en[2]   = { EN_X, EN_Y };
+    for (int i = 0; i < 2; ++i) {
+        if (p == dir[i]) direcao[i] = v;
+        else if (p == en[i]) habilitado[i] = !v;
+        else if (p == step[i] && v) {
+            // borda de subida: um passo, sentido 0 → posição crescente
+            if (!habilitado[i]) { eixos[i].desabilitado++; return; }
+            mover(i, direcao[i] == 0 ? 2 : -2);
+        }
+    }
+    if (p == PIPETA) valvula(v);
+}
+
+static void barramento(const PinName* p, int n, int v) {
+    if (n != 4 || p[0] != Z_A1) return;
+    int a = anguloBobinas(v);
+    if (a < 0) return;                    // bobinas soltas: o rotor fica onde está
+    if (anguloZ >= 0) {
+        int d = (a - anguloZ + 8) % 8;
+        if (d == 1 || d == 2)      mover(2, d);
+        else if (d == 7 || d == 6) mover(2, d - 8);
+        else if (d == 4)           saltos++;
+    }
+    anguloZ = a;
+}
+
+void instalar(bool comEco) {
+    eco = comEco;
+    sim::aoEscrever(saida);
+    sim::aoEscreverBarramento(barramento);
+    for (Eixo& e : eixos) atualizarFins(e);
+}
+
+}
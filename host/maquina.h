@@ -0,0 +1,59 @@
+// maquina.h (host)
+// Modelo cinemático da máquina sobre a HAL de host: os pulsos STEP/DIR e as
+// bobinas do Z viram posições dos eixos, os fins de curso disparam nos
+// extremos do curso e cada pulso da válvula é registrado com a posição.
+// Percurso, ciclos do Z e acionamentos só contam dentro da janela medida.
+#ifndef HOST_MAQUINA_H
+#define HOST_MAQUINA_H
+
+#include <vector>
+
+#include "sim.h"
+
+namespace maquina {
+
+using sim::Tempo;
+
+// Posições em unidades do firmware (2 por passo em X/Y, meio passo no Z); mm = u/80
+constexpr float U_POR_MM = 80.0f;
+
+struct Eixo {
+    const char* nome;
+    int32_t     pos;        // posição física
+    int32_t     minimo;     // fim de curso inferior (pressionado em pos <= minimo)
+    int32_t     maximo;     // fim de curso superior (pressionado em pos >= maximo)
+    PinName     fimMin, fimMax;
+    long        passos = 0;
+    long        desabilitado = 0;   // pulsos com o driver desligado (não movem)
+    long        alemDoFim = 0;      // passos além do fim de curso
+};
+extern Eixo eixos[3];
+
+// Válvula da pipeta: cada acionamento é um pulso em nível baixo
+struct Acionamento {
+    Tempo inicio, duracao;
+    float mm[3];
+};
+
+struct Janela {
+    bool  aberta = false;
+    Tempo inicio{0}, fim{0};
+    Tempo emMovimento{0};       // intervalos entre passos de até 20 ms
+    long  pausas = 0;           // intervalos entre passos acima de 20 ms
+    long  percurso[3] = {};     // unidades percorridas por eixo
+    long  ciclosZ = 0;          // descidas do Z seguidas de subida
+    std::vector<Acionamento> acionamentos;
+    Tempo duracao() const { return fim - inicio; }
+};
+const Janela& janela();
+void abrir();                   // zera e abre a janela no instante atual
+void fechar();
+
+// Liga o modelo às saídas da HAL e posiciona os fins de curso; com eco, cada
+// acionamento dentro da janela é impresso na linha do tempo
+void instalar(bool eco);
+long saltosZ();                 // trocas de bobina impossíveis (2 passos de uma vez)
+
+}
+
+#endif // HOST_MAQUINA_H
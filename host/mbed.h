@@ -0,0 +1,459 @@
+// mbed.h (host)
+// Substituto da HAL do mbed OS 6 para compilar o firmware no Linux.
+// Só cobre o que a Pipetadora e o TextLCD usam. O tempo é virtual: as threads
+// rodam uma de cada vez (maior prioridade primeiro) e o relógio só anda em
+// sleep_for/wait_us/esperas; os eventos de timer e as bordas das entradas
+// rodam como ISR nesses pontos. Ver sim.h para o lado do simulador.
+#ifndef HOST_MBED_H
+#define HOST_MBED_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <sys/types.h>
+#include <cmath>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+typedef enum {
+    NC = -1,
+    PA_0 = 0x00, PA_1, PA_2, PA_3, PA_4, PA_5, PA_6, PA_7, PA_8, PA_9, PA_10, PA_11, PA_12, PA_13, PA_14, PA_15,
+    PB_0 = 0x10, PB_1, PB_2, PB_3, PB_4, PB_5, PB_6, PB_7, PB_8, PB_9, PB_10, PB_11, PB_12, PB_13, PB_14, PB_15,
+    PC_0 = 0x20, PC_1, PC_2, PC_3, PC_4, PC_5, PC_6, PC_7, PC_8, PC_9, PC_10, PC_11, PC_12, PC_13, PC_14, PC_15,
+    PD_0 = 0x30, PD_1, PD_2,
+    // Arduino (NUCLEO-F446RE)
+    D0 = PA_3, D1 = PA_2, D2 = PA_10, D3 = PB_3, D4 = PB_5, D5 = PB_4, D6 = PB_10, D7 = PA_8,
+    D8 = PA_9, D9 = PC_7, D10 = PB_6, D11 = PA_7, D12 = PA_6, D13 = PA_5, D14 = PB_9, D15 = PB_8,
+    LED1 = PA_5, USBTX = PA_2, USBRX = PA_3,
+    // nomes LPC1768 dos exemplos do TextLCD
+    p5 = 0x40, p6, p7, p8, p9, p10, p27 = 0x50, p28
+} PinName;
+
+typedef enum { PullNone, PullUp, PullDown } PinMode;
+
+typedef uint64_t us_timestamp_t;
+
+#define osWaitForever         0xFFFFFFFFU
+#define osFlagsError          0x80000000U
+#define osFlagsErrorTimeout   0xFFFFFFFEU
+
+#define DEVICE_I2C_ASYNCH     1
+#define I2C_EVENT_ERROR               (1 << 1)
+#define I2C_EVENT_ERROR_NO_SLAVE      (1 << 2)
+#define I2C_EVENT_TRANSFER_COMPLETE   (1 << 3)
+#define I2C_EVENT_TRANSFER_EARLY_NACK (1 << 4)
+#define I2C_EVENT_ALL (I2C_EVENT_ERROR | I2C_EVENT_TRANSFER_COMPLETE | I2C_EVENT_ERROR_NO_SLAVE | I2C_EVENT_TRANSFER_EARLY_NACK)
+
+#define MBED_ASSERT(x)         do { if (!(x)) error("MBED_ASSERT: %s", #x); } while (0)
+#define MBED_FORCEINLINE       inline
+#define MBED_DEPRECATED_SINCE(d, m)
+
+// Núcleo do tempo virtual (hal.cpp)
+namespace sim {
+using Tempo = std::chrono::microseconds;   // desde o início da simulação
+
+Tempo agora();
+// Espera ocupada da thread atual (wait_us, escritas I2C bloqueantes)
+void  ocupar(Tempo d);
+// Suspende a thread atual por d; arquivo/linha identificam o sleep_for no relatório
+void  dormir(Tempo d, const char* arquivo, int linha);
+// Bloqueia a thread atual até pronto() ou até o prazo (Tempo::max() → sem prazo)
+bool  esperar(const std::function<bool()>& pronto, Tempo prazo);
+// Cede a CPU se a mudança de estado liberou uma thread de prioridade maior
+void  preempcao();
+bool  emIsr();
+
+// Eventos de timer: fn roda como ISR no instante quando; retorna o id
+uint32_t agendar(Tempo quando, std::function<void()> fn);
+void     cancelar(uint32_t id);
+
+struct Tarefa;
+Tarefa*  criarTarefa(int prioridade, const char* nome, std::function<void()> corpo);
+Tarefa*  tarefaAtual();
+uint32_t& flagsTarefa(Tarefa* t);
+
+// Pinos
+void registrarEntrada(PinName p, PinMode m);
+int  nivel(PinName p);
+void escrever(PinName p, int v);                          // DigitalOut
+void escreverBarramento(const PinName* p, int n, int v);  // BusOut
+void registrarBorda(PinName p, std::function<void()> subida, std::function<void()> descida);
+
+// UART do console (UnbufferedSerial): os bytes recebidos esperam o read() da
+// ISR de recepção; o envio ocupa a thread pelo tempo de transmissão
+void serialAbrir(int baud);
+void serialIsr(std::function<void()> f);
+int  serialLer(char* c);               // 0 sem byte recebido
+void serialEnviar(const char* d, size_t n);
+
+}
+
+namespace mbed {
+
+template <typename F> class Callback;
+
+template <typename R, typename... A>
+class Callback<R(A...)> : public std::function<R(A...)> {
+public:
+    Callback() {}
+    Callback(std::nullptr_t) {}
+    Callback(R (*f)(A...)) : std::function<R(A...)>(f) {}
+    template <typename T, typename M>
+    Callback(T* obj, M metodo) : std::function<R(A...)>([obj, metodo](A... a) { return (obj->*metodo)(a...); }) {}
+    template <typename F, typename = decltype(std::declval<F>()(std::declval<A>()...))>
+    Callback(F f) : std::function<R(A...)>(f) {}
+};
+
+template <typename R, typename... A>
+Callback<R(A...)> callback(R (*f)(A...)) { return Callback<R(A...)>(f); }
+template <typename U, typename T, typename R, typename... A>
+Callback<R(A...)> callback(U* obj, R (T::*metodo)(A...)) { return Callback<R(A...)>(static_cast<T*>(obj), metodo); }
+
+typedef Callback<void(int)> event_callback_t;
+
+class CriticalSectionLock {
+public:
+    // Sem preempção real: as ISR só rodam quando a thread espera
+    CriticalSectionLock() {}
+    ~CriticalSectionLock() {}
+    static void enable() {}
+    static void disable() {}
+};
+
+class DigitalOut {
+public:
+    DigitalOut(PinName pin, int valor = 0) : _pin(pin) { write(valor); }
+    void write(int valor)              { _valor = valor ? 1 : 0; if (_pin != NC) sim::escrever(_pin, _valor); }
+    int  read()                        { return _valor; }
+    int  is_connected()                { return _pin != NC; }
+    DigitalOut& operator=(int valor)   { write(valor); return *this; }
+    DigitalOut& operator=(DigitalOut& o) { write(o.read()); return *this; }
+    operator int()                     { return read(); }
+private:
+    PinName _pin;
+    int     _valor = 0;
+};
+
+class DigitalIn {
+public:
+    DigitalIn(PinName pin, PinMode modo = PullNone) : _pin(pin) { sim::registrarEntrada(pin, modo); }
+    int  read()            { return sim::nivel(_pin); }
+    void mode(PinMode m)   { sim::registrarEntrada(_pin, m); }
+    int  is_connected()    { return _pin != NC; }
+    operator int()         { return read(); }
+private:
+    PinName _pin;
+};
+
+class InterruptIn {
+public:
+    InterruptIn(PinName pin, PinMode modo = PullNone);
+    void rise(Callback<void()> f)  { _subida = f; }
+    void fall(Callback<void()> f)  { _descida = f; }
+    int  read()                    { return sim::nivel(_pin); }
+    void mode(PinMode m)           { sim::registrarEntrada(_pin, m); }
+    void enable_irq()              { _habilitado = true; }
+    void disable_irq()             { _habilitado = false; }
+    operator int()                 { return read(); }
+private:
+    PinName          _pin;
+    bool             _habilitado = true;
+    Callback<void()> _subida, _descida;
+};
+
+class BusOut {
+public:
+    template <typename... P>
+    BusOut(P... pinos) : _pinos{pinos...} {}
+    void write(int valor)          { _valor = valor; sim::escreverBarramento(_pinos.data(), int(_pinos.size()), valor); }
+    int  read()                    { return _valor; }
+    BusOut& operator=(int valor)   { write(valor); return *this; }
+    operator int()                 { return read(); }
+private:
+    std::vector<PinName> _pinos;
+    int                  _valor = 0;
+};
+
+class TickerDataClock {
+public:
+    typedef std::chrono::microseconds                         duration;
+    typedef duration::rep                                     rep;
+    typedef duration::period                                  period;
+    typedef std::chrono::time_point<TickerDataClock, duration> time_point;
+    static const bool is_steady = true;
+    time_point now() { return time_point(sim::agora()); }
+};
+
+class TimerEvent {
+public:
+    TimerEvent() {}
+    virtual ~TimerEvent() { remove(); }
+protected:
+    virtual void handler() = 0;
+    void insert(std::chrono::microseconds rel)                 { insert_absolute(_ticker_data.now() + rel); }
+    void insert_absolute(TickerDataClock::time_point quando);
+    void remove()                                              { if (_evento) sim::cancelar(_evento); _evento = 0; }
+    TickerDataClock _ticker_data;
+private:
+    uint32_t _evento = 0;
+};
+
+class Timer {
+public:
+    void start()   { if (!_rodando) { _inicio = sim::agora(); _rodando = true; } }
+    void stop()    { if (_rodando) { _acumulado += sim::agora() - _inicio; _rodando = false; } }
+    void reset()   { _acumulado = sim::Tempo(0); _inicio = sim::agora(); }
+    std::chrono::microseconds elapsed_time() const {
+        return _acumulado + (_rodando ? sim::agora() - _inicio : sim::Tempo(0));
+    }
+    int read_ms() const { return int(elapsed_time().count() / 1000); }
+private:
+    bool       _rodando = false;
+    sim::Tempo _inicio{0};
+    sim::Tempo _acumulado{0};
+};
+
+class Ticker : public TimerEvent {
+public:
+    void attach(Callback<void()> f, std::chrono::microseconds t) { _f = f; _periodo = t; insert(t); }
+    void detach() { remove(); _f = nullptr; }
+protected:
+    void handler() override { insert(_periodo); if (_f) _f(); }
+    Callback<void()>          _f;
+    std::chrono::microseconds _periodo{0};
+};
+
+class Timeout : public Ticker {
+protected:
+    void handler() override { if (_f) _f(); }
+};
+
+class I2C {
+public:
+    enum Acks { NoACK = 0, ACK = 1 };
+    I2C(PinName sda, PinName scl) { (void) sda; (void) scl; }
+    void frequency(int hz) { _hz = hz; }
+    int  write(int endereco, const char* dados, int n, bool repetido = false);
+    int  read(int endereco, char* dados, int n, bool repetido = false);
+    int  write(int dado)  { (void) dado; sim::ocupar(sim::Tempo(9 * 1000000 / _hz)); return ACK; }
+    int  read(int ack)    { (void) ack; sim::ocupar(sim::Tempo(9 * 1000000 / _hz)); return 0xFF; }
+    void start() {}
+    void stop() {}
+    void lock() {}
+    void unlock() {}
+    // Transferência assíncrona: a conclusão chega como ISR após a duração no barramento
+    int  transfer(int endereco, const char* tx, int ntx, char* rx, int nrx,
+                  const event_callback_t& cb, int eventos = I2C_EVENT_TRANSFER_COMPLETE, bool repetido = false);
+    void abort_transfer() {}
+private:
+    int _hz = 100000;
+};
+
+class SPI {
+public:
+    SPI(PinName mosi, PinName miso, PinName sclk, PinName ssel = NC) { (void) mosi; (void) miso; (void) sclk; (void) ssel; }
+    void format(int bits, int modo = 0) { (void) bits; (void) modo; }
+    void frequency(int hz)              { _hz = hz; }
+    int  write(int v)                   { sim::ocupar(sim::Tempo(8 * 1000000 / _hz + 1)); return v; }
+private:
+    int _hz = 1000000;
+};
+
+class Stream {
+public:
+    Stream(const char* nome = nullptr) { (void) nome; }
+    virtual ~Stream() {}
+    int putc(int c) { return _putc(c); }
+    int getc()      { return _getc(); }
+    int printf(const char* formato, ...) {
+        char buf[256];
+        va_list a;
+        va_start(a, formato);
+        int n = vsnprintf(buf, sizeof(buf), formato, a);
+        va_end(a);
+        if (n > int(sizeof(buf)) - 1) n = sizeof(buf) - 1;
+        for (int i = 0; i < n; ++i) _putc((unsigned char) buf[i]);
+        return n;
+    }
+protected:
+    virtual int _putc(int c) = 0;
+    virtual int _getc() = 0;
+};
+
+class FileHandle {
+public:
+    virtual ~FileHandle() {}
+    virtual ssize_t read(void* buf, size_t n) = 0;
+    virtual ssize_t write(const void* buf, size_t n) = 0;
+};
+
+class SerialBase {
+public:
+    enum IrqType { RxIrq = 0, TxIrq };
+};
+
+// Só a UART do console (USBTX/USBRX); o outro lado é ligado pelo simulador (sim.h)
+class UnbufferedSerial : public FileHandle, public SerialBase {
+public:
+    UnbufferedSerial(PinName tx, PinName rx, int baud = 9600) { (void) tx; (void) rx; sim::serialAbrir(baud); }
+    void    baud(int b)                                          { sim::serialAbrir(b); }
+    void    attach(Callback<void()> f, IrqType tipo = RxIrq)     { if (tipo == RxIrq) sim::serialIsr(f); }
+    ssize_t read(void* buf, size_t n) override                   { return n ? sim::serialLer(static_cast<char*>(buf)) : 0; }
+    ssize_t write(const void* buf, size_t n) override            { sim::serialEnviar(static_cast<const char*>(buf), n); return ssize_t(n); }
+};
+
+// Fila de eventos compartilhada: despachada por uma thread de prioridade normal
+class EventQueue {
+public:
+    template <typename F> int call(F f) { return post(Callback<void()>(f)); }
+    template <typename T, typename M> int call(T* obj, M metodo) { return post(Callback<void()>(obj, metodo)); }
+    void dispatch_forever();
+private:
+    int post(Callback<void()> f);
+    std::vector<Callback<void()>> _fila;
+};
+EventQueue* mbed_event_queue();
+
+} // namespace mbed
+
+namespace rtos {
+
+enum osPriority {
+    osPriorityIdle = 1, osPriorityLow = 8, osPriorityBelowNormal = 16, osPriorityNormal = 24,
+    osPriorityAboveNormal = 32, osPriorityHigh = 40, osPriorityRealtime = 48
+};
+
+class Thread {
+public:
+    Thread(osPriority prioridade = osPriorityNormal, uint32_t pilha = 4096,
+           unsigned char* memoria = nullptr, const char* nome = nullptr)
+        : _prioridade(prioridade), _nome(nome) { (void) pilha; (void) memoria; }
+    int start(mbed::Callback<void()> corpo) {
+        _tarefa = sim::criarTarefa(_prioridade, _nome ? _nome : "thread", corpo);
+        return 0;
+    }
+    uint32_t flags_set(uint32_t f);
+    int join() { return 0; }
+    const char* get_name() const { return _nome; }
+private:
+    osPriority  _prioridade;
+    const char* _nome;
+    sim::Tarefa* _tarefa = nullptr;
+};
+
+class Mutex {
+public:
+    void lock();
+    bool trylock();
+    void unlock();
+private:
+    sim::Tarefa* _dono = nullptr;
+    int          _contagem = 0;
+};
+
+class Semaphore {
+public:
+    Semaphore(int32_t contagem = 0, uint16_t maximo = 0xFFFF) : _contagem(contagem), _maximo(maximo) {}
+    void acquire()     { sim::esperar([this] { return _contagem > 0; }, sim::Tempo::max()); --_contagem; }
+    bool try_acquire() { if (_contagem == 0) return false; --_contagem; return true; }
+    bool try_acquire_for(std::chrono::milliseconds t) {
+        if (!sim::esperar([this] { return _contagem > 0; }, sim::agora() + t)) return false;
+        --_contagem;
+        return true;
+    }
+    int release() { if (_contagem < _maximo) ++_contagem; if (!sim::emIsr()) sim::preempcao(); return 0; }
+private:
+    int32_t  _contagem;
+    uint16_t _maximo;
+};
+
+class EventFlags {
+public:
+    uint32_t set(uint32_t f)                       { _flags |= f; uint32_t r = _flags; if (!sim::emIsr()) sim::preempcao(); return r; }
+    uint32_t clear(uint32_t f = 0x7FFFFFFF)        { uint32_t r = _flags; _flags &= ~f; return r; }
+    uint32_t get() const                           { return _flags; }
+    uint32_t wait_any(uint32_t f, uint32_t timeout = osWaitForever, bool limpar = true) { return esperar(f, false, timeout, limpar); }
+    uint32_t wait_all(uint32_t f, uint32_t timeout = osWaitForever, bool limpar = true) { return esperar(f, true, timeout, limpar); }
+private:
+    uint32_t esperar(uint32_t f, bool todos, uint32_t timeout, bool limpar);
+    uint32_t _flags = 0;
+};
+
+class Kernel {
+public:
+    struct Clock {
+        typedef std::chrono::milliseconds                 duration;
+        typedef duration::rep                             rep;
+        typedef duration::period                          period;
+        typedef std::chrono::time_point<Clock, duration>  time_point;
+        static const bool is_steady = true;
+        static time_point now() { return time_point(std::chrono::duration_cast<duration>(sim::agora())); }
+    };
+};
+
+namespace ThisThread {
+// sleep_for é uma macro (abaixo) que acrescenta arquivo e linha
+inline void sleep_for_em(uint32_t ms, const char* arquivo, int linha) { sim::dormir(std::chrono::milliseconds(ms), arquivo, linha); }
+template <typename R, typename P>
+void sleep_for_em(std::chrono::duration<R, P> d, const char* arquivo, int linha) {
+    sim::dormir(std::chrono::duration_cast<sim::Tempo>(d), arquivo, linha);
+}
+inline void sleep_until(Kernel::Clock::time_point t) {
+    if (t > Kernel::Clock::now()) sim::dormir(t - Kernel::Clock::now(), "sleep_until", 0);
+}
+uint32_t flags_wait_any(uint32_t f, bool limpar = true);
+uint32_t flags_wait_all(uint32_t f, bool limpar = true);
+uint32_t flags_clear(uint32_t f);
+inline void yield() { sim::preempcao(); }
+}
+
+} // namespace rtos
+
+using namespace mbed;
+using namespace rtos;
+
+void error(const char* formato, ...);
+
+inline void wait_us(int us)                 { sim::ocupar(sim::Tempo(us)); }
+inline uint32_t us_ticker_read()            { return uint32_t(sim::agora().count()); }
+inline void thread_sleep_for_em(uint32_t ms, const char* arquivo, int linha) {
+    sim::dormir(std::chrono::milliseconds(ms), arquivo, linha);
+}
+
+#define sleep_for(d)        sleep_for_em(d, __FILE__, __LINE__)
+#define thread_sleep_for(d) thread_sleep_for_em(d, __FILE__, __LINE__)
+
+inline uint32_t core_util_atomic_load_u32(const volatile uint32_t* p)   { return *p; }
+inline void     core_util_atomic_store_u32(volatile uint32_t* p, uint32_t v) { *p = v; }
+inline uint32_t core_util_atomic_incr_u32(volatile uint32_t* p, uint32_t d) { return *p += d; }
+inline uint32_t core_util_atomic_decr_u32(volatile uint32_t* p, uint32_t d) { return *p -= d; }
+inline void     core_util_critical_section_enter() {}
+inline void     core_util_critical_section_exit() {}
+
+// Núcleo Cortex-M4 do F446RE a 180 MHz: o contador de ciclos do DWT segue o
+// tempo virtual (o tempo de execução das ISR não é modelado)
+extern uint32_t SystemCoreClock;
+
+struct ContadorCiclos {
+    uint32_t base = 0;
+    uint32_t agora() const { return uint32_t(sim::agora().count() * (SystemCoreClock / 1000000)); }
+    operator uint32_t() const { return agora() - base; }
+    ContadorCiclos& operator=(uint32_t v) { base = agora() - v; return *this; }
+};
+struct DWT_Type       { volatile uint32_t CTRL; ContadorCiclos CYCCNT; };
+struct CoreDebug_Type { volatile uint32_t DEMCR; };
+extern DWT_Type       dwtHost;
+extern CoreDebug_Type coreDebugHost;
+#define DWT                        (&dwtHost)
+#define CoreDebug                  (&coreDebugHost)
+#define DWT_CTRL_CYCCNTENA_Msk     (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+// O main() do firmware roda como a thread principal do simulador
+#define main app_main
+int app_main();
+
+#endif // HOST_MBED_H
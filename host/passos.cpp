@@ -0,0 +1,117 @@
+// passos.cpp (host)
+#include <algorithm>
+#include <cmath>
+
+#include "passos.h"
+
+namespace passos {
+
+// Período planejado acima do maior valor das tabelas (uint16) → outro movimento
+static constexpr uint32_t NOVO_MOVIMENTO_US = 65535;
+
+bool ler(FILE* f, Captura& c) {
+    char linha[96];
+    bool ref = false;
+    while (fgets(linha, sizeof(linha), f)) {
+        unsigned long a, b, d, e;
+        if (sscanf(linha, "#passos %lu %lu %lu", &a, &b, &d) == 3) {
+            c.ref.hz     = uint32_t(a);
+            c.ref.ciclos = uint32_t(b);
+            c.ref.us     = uint32_t(d);
+            ref = true;
+        } else if (sscanf(linha, "#perdidas %lu", &a) == 1) {
+            c.perdidas += long(a);
+        } else if (sscanf(linha, "%lu %lu %lu %lu", &a, &b, &d, &e) == 4 && a < 3) {
+            Pipetadora_Marca m;
+            m.eixo   = uint8_t(a);
+            m.passo  = uint8_t(b);
+            m.ciclos = uint32_t(d);
+            m.prazo  = uint32_t(e);
+            c.marcas.push_back(m);
+        }
+    }
+    return ref;
+}
+
+static double percentil(std::vector<float>& v, double p) {
+    if (v.empty()) return 0;
+    size_t k = std::min(v.size() - 1, size_t(p * (v.size() - 1) + 0.5));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+void analisar(const Captura& c, Eixo eixos[3]) {
+    // ciclos esperados no prazo p: p·mhz + deslocamento (aritmética módulo 2^32,
+    // válida enquanto o atraso for menor que meia volta do contador)
+    const uint32_t mhz   = c.ref.hz / 1000000;
+    const uint32_t desl  = c.ref.ciclos - c.ref.us * mhz;
+
+    struct Estado {
+        bool     anterior = false;
+        uint32_t prazo = 0;
+        double   atraso = 0;
+        double   t = 0;               // tempo real desde o início do movimento (us)
+        double   ultimoPasso = -1;
+        long     passosAtivos = 0;
+        std::vector<float> erros;
+    } est[3];
+
+    for (int i = 0; i < 3; ++i) eixos[i] = Eixo();
+    for (const Pipetadora_Marca& m : c.marcas) {
+        if (m.eixo >= 3 || mhz == 0) continue;
+        Eixo&   e = eixos[m.eixo];
+        Estado& s = est[m.eixo];
+        double atraso = int32_t(m.ciclos - (m.prazo * mhz + desl)) / double(mhz);
+        e.bordas++;
+        e.passos += m.passo;
+        e.atrasoMax = std::max(e.atrasoMax, atraso);
+
+        uint32_t dp = m.prazo - s.prazo;
+        if (!s.anterior || dp > NOVO_MOVIMENTO_US) {
+            s.t = 0;
+            s.ultimoPasso = -1;
+        } else {
+            double erro = atraso - s.atraso;
+            if (s.erros.empty()) e.erroMin = e.erroMax = erro;
+            e.erroMin = std::min(e.erroMin, erro);
+            e.erroMax = std::max(e.erroMax, erro);
+            s.erros.push_back(float(fabs(erro)));
+            if (atraso >= dp) e.perdidos++;
+            s.t += dp + erro;
+            e.ativo_s += (dp + erro) / 1e6;
+            if (m.passo) s.passosAtivos++;
+        }
+        if (m.passo) {
+            if (s.ultimoPasso >= 0 && s.t > s.ultimoPasso) e.hzPico = std::max(e.hzPico, 1e6 / (s.t - s.ultimoPasso));
+            s.ultimoPasso = s.t;
+        }
+        s.anterior = true;
+        s.prazo    = m.prazo;
+        s.atraso   = atraso;
+    }
+    for (int i = 0; i < 3; ++i) {
+        Eixo& e = eixos[i];
+        if (e.ativo_s > 0) e.hzMedio = est[i].passosAtivos / e.ativo_s;
+        e.p50  = percentil(est[i].erros, 0.50);
+        e.p99  = percentil(est[i].erros, 0.99);
+        e.p999 = percentil(est[i].erros, 0.999);
+    }
+}
+
+void imprimir(const Eixo eixos[3], long perdidas, int recuo) {
+    static const char* nomes[3] = { "x", "y", "z" };
+    printf("{\n");
+    printf("%*s\"bordas_perdidas_no_buffer\": %ld,\n", recuo + 2, "", perdidas);
+    for (int i = 0; i < 3; ++i) {
+        const Eixo& e = eixos[i];
+        printf("%*s\"%s\": { \"bordas\": %ld, \"passos\": %ld, \"em_movimento_s\": %.3f, "
+               "\"hz_medio\": %.1f, \"hz_pico\": %.1f, \"erro_min_us\": %.2f, \"erro_max_us\": %.2f, "
+               "\"erro_p50_us\": %.2f, \"erro_p99_us\": %.2f, \"erro_p999_us\": %.2f, "
+               "\"atraso_max_us\": %.2f, \"prazos_perdidos\": %ld }%s\n",
+               recuo + 2, "", nomes[i], e.bordas, e.passos, e.ativo_s, e.hzMedio, e.hzPico,
+               e.erroMin, e.erroMax, e.p50, e.p99, e.p999, e.atrasoMax, e.perdidos, i < 2 ? "," : "");
+    }
+    printf("%*s}", recuo, "");
+}
+
+}
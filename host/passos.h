@@ -0,0 +1,43 @@
+// passos.h (host)
+// Análise da captura de bordas de passo (STEP_TRACE): o atraso de cada borda
+// em relação ao prazo planejado sai do DWT->CYCCNT convertido pela referência
+// da captura; o erro de intervalo é a diferença de atraso entre bordas
+// seguidas do mesmo eixo. Serve tanto para o simulador quanto para o despejo
+// de Pipetadora_TraceDump capturado do console da placa.
+#ifndef HOST_PASSOS_H
+#define HOST_PASSOS_H
+
+#include <cstdio>
+#include <vector>
+
+#include "Pipetadora.h"
+
+namespace passos {
+
+struct Captura {
+    Pipetadora_RefCaptura         ref = {};
+    std::vector<Pipetadora_Marca> marcas;
+    long                          perdidas = 0;   // sobrescritas antes da leitura
+};
+
+// Lê o formato de Pipetadora_TraceDump; false sem a linha de referência
+bool ler(FILE* f, Captura& c);
+
+struct Eixo {
+    long   bordas = 0, passos = 0;
+    long   perdidos = 0;        // borda saiu depois do prazo da seguinte (atraso >= período planejado)
+    double ativo_s = 0;         // soma dos intervalos dentro dos movimentos
+    double hzMedio = 0;         // passos por segundo em movimento
+    double hzPico  = 0;         // menor intervalo entre passos seguidos
+    double erroMin = 0, erroMax = 0;     // intervalo real - planejado (us)
+    double p50 = 0, p99 = 0, p999 = 0;   // |erro| (us)
+    double atrasoMax = 0;                // borda após o prazo (us)
+};
+
+void analisar(const Captura& c, Eixo eixos[3]);
+// Objeto JSON {"perdidas":..,"x":{..},"y":{..},"z":{..}}; recuo é o da primeira linha
+void imprimir(const Eixo eixos[3], long perdidas, int recuo);
+
+}
+
+#endif // HOST_PASSOS_H
@@ -0,0 +1,3 @@
+// rtos/ThisThread.h (host)
+// O ThisThread da HAL de host está em mbed.h
+#include "../mbed.h"
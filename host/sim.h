@@ -0,0 +1,85 @@
+// sim.h (host)
+// Lado do simulador da HAL de host: observa as saídas, aciona as entradas,
+// lê a tela do LCD decodificada do barramento I2C e controla a execução.
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include "mbed.h"
+#include <string>
+
+namespace sim {
+
+// Observadores das saídas (chamados no instante da escrita)
+void aoEscrever(std::function<void(PinName, int)> f);
+void aoEscreverBarramento(std::function<void(const PinName*, int, int)> f);
+
+// Entrada controlada pelo simulador; uma borda chama as ISR do InterruptIn
+void definirEntrada(PinName p, int v);
+
+// UART do console: f recebe o que o firmware transmite, ao fim de cada write;
+// receberSerial entrega um byte e roda a ISR de recepção (fora de thread: ISR)
+void aoTransmitir(std::function<void(const char*, size_t)> f);
+void receberSerial(char c);
+int  baudSerial();                      // 0 sem UART aberta
+
+// LCD HD44780 atrás do PCF8574, montado a partir dos quadros enviados no I2C
+void        configurarLcd(int colunas, int linhas);
+std::string linhaLcd(int linha);        // UDC (0..7) aparecem como '#'
+bool        telaContem(const char* texto);
+
+struct EstatI2c {
+    long  transacoes = 0;
+    long  bytes      = 0;   // endereço incluído
+    Tempo ocupado{0};       // tempo de barramento
+};
+const EstatI2c& i2c();
+
+// Escritas que o HD44780 executou, decodificadas dos quadros do I2C
+struct EstatLcd {
+    long dados     = 0;   // caracteres e glifos (RS=1)
+    long enderecos = 0;   // comandos de endereço da DDRAM (0x80|endereço)
+};
+const EstatLcd& lcd();
+
+// Eventos de timer (Ticker, Timeout, TimerEvent, fim de transferência I2C)
+struct EstatTimer {
+    long agendados  = 0;
+    long cancelados = 0;    // removidos antes de vencer
+    long disparos   = 0;    // entradas de ISR de timer
+};
+const EstatTimer& timers();
+
+// Tempo de cada sleep_for (por local no fonte e thread)
+struct Sono {
+    std::string local;
+    std::string tarefa;
+    long        vezes = 0;
+    Tempo       total{0};
+};
+std::vector<Sono> sonos();
+
+struct EstatTarefa {
+    std::string nome;
+    int         prioridade;
+    Tempo       ocupada{0};    // wait_us e escritas I2C bloqueantes
+    Tempo       dormindo{0};   // sleep_for
+    Tempo       esperando{0};  // flags, mutex, fila de eventos
+};
+std::vector<EstatTarefa> tarefas();
+Tempo ociosa();                // nenhuma thread pronta
+
+// Atraso de entrada de cada ISR de timer: fixa + 0..variavel (pseudoaleatório,
+// igual em toda execução). Padrão 0: as ISR rodam no instante exato.
+void latenciaIsr(Tempo fixa, Tempo variavel);
+
+// Cria a thread principal (osPriorityNormal) que executa corpo
+void iniciar(std::function<void()> corpo);
+// Roda até terminar() ou até o tempo virtual passar de limite; retorna o código
+// de terminar(), 2 para impasse (nada pronto nem agendado) e 3 para limite
+int  executar(Tempo limite);
+void terminar(int codigo);
+const char* motivo();
+
+}
+
+#endif // HOST_SIM_H
@@ -0,0 +1,366 @@
+// simulador.cpp (host)
+// Simulador da máquina inteira em tempo virtual: o main() do firmware roda sem
+// alterações sobre a HAL de host, os pulsos STEP/DIR e as bobinas do Z viram
+// posições dos eixos, os fins de curso disparam nos extremos do curso e um
+// roteiro aperta os botões conforme o que aparece no LCD. Ao final imprime a
+// linha do tempo: ciclo por poço, tempo parado, CPU ociosa e cada sleep_for.
+//
+//   simulador [limite_s] [--registro saida.csv|saida.json]
+//                            (padrão 900 s de tempo virtual; grava o registro de eventos ao final)
+//   simulador bancada ...    (protocolos canônicos em JSON, ver bancada.cpp)
+//   simulador passos arquivo (análise do despejo de Pipetadora_TraceDump da placa)
+//   simulador registro arquivo [csv|chrome]
+//                            (decodifica o despejo de Registro_Dump da placa)
+//   simulador gcode arquivo ...
+//                            (envia o arquivo ao terminal serial por um pty, ver gcode.cpp)
+//   simulador verificar [nome...]
+//                            (verificações de regressão contra referências medidas, ver verificar.cpp)
+#include "maquina.h"
+#include "passos.h"
+#include "Perfil.h"
+#include "eventos.h"
+#include "pinos.h"
+
+#include <cstring>
+#include <string>
+
+#undef main   // mbed.h renomeia o main() do firmware para app_main()
+
+using namespace std::chrono;
+using sim::Tempo;
+using maquina::U_POR_MM;
+
+static double seg(Tempo t) { return t.count() / 1e6; }
+
+//======================================================================
+// Roteiro: botões apertados conforme a tela
+//======================================================================
+
+struct Passo {
+    enum Tipo { TELA, APERTA, ATE, SEGURA, ESPERA, MARCA } tipo;
+    const char* texto;
+    PinName     pino;
+    int         ms;
+};
+
+static std::vector<Passo> roteiro;
+static size_t passoAtual  = 0;
+static Tempo  inicioPasso{0};
+static Tempo  livreEm{0};      // fim do aperto em curso + intervalo do debounce
+static int    tentativas  = 0;
+
+static const Tempo VERIFICACAO = milliseconds(10);
+static const Tempo DEBOUNCE    = milliseconds(300);   // o firmware ignora bordas por 200 ms
+static const Tempo TIMEOUT     = seconds(120);
+
+static void apertar(PinName p, int ms) {
+    sim::definirEntrada(p, 1);
+    sim::agendar(sim::agora() + milliseconds(ms), [p] { sim::definirEntrada(p, 0); });
+    livreEm = sim::agora() + milliseconds(ms) + DEBOUNCE;
+}
+
+static void mostrarTela() {
+    for (int r = 0; r < 4; ++r) printf("      |%s|\n", sim::linhaLcd(r).c_str());
+}
+
+static void proximo(const char* descricao) {
+    if (descricao) printf("  %9.3f s  %s\n", seg(sim::agora()), descricao);
+    ++passoAtual;
+    tentativas  = 0;
+    inicioPasso = sim::agora();
+}
+
+static void verificar() {
+    Tempo t = sim::agora();
+    sim::agendar(t + VERIFICACAO, verificar);
+    if (t < livreEm) return;
+    if (passoAtual >= roteiro.size()) {
+        sim::terminar(0);
+        return;
+    }
+    if (t - inicioPasso > TIMEOUT) {
+        const Passo& p = roteiro[passoAtual];
+        printf("  %9.3f s  ROTEIRO PARADO no passo %zu (%s)\n", seg(t), passoAtual, p.texto ? p.texto : "");
+        mostrarTela();
+        sim::terminar(1);
+        return;
+    }
+
+    const Passo& p = roteiro[passoAtual];
+    char d[96];
+    switch (p.tipo) {
+        case Passo::TELA:
+            if (!sim::telaContem(p.texto)) return;
+            snprintf(d, sizeof(d), "tela \"%s\"", p.texto);
+            proximo(d);
+            break;
+        case Passo::APERTA:
+            apertar(p.pino, 100);
+            proximo(nullptr);
+            break;
+        case Passo::SEGURA:
+            snprintf(d, sizeof(d), "segura %s por %d ms", p.texto, p.ms);
+            apertar(p.pino, p.ms);
+            proximo(d);
+            break;
+        case Passo::ATE:
+            if (sim::telaContem(p.texto)) {
+                snprintf(d, sizeof(d), "tela \"%s\" (%d toques)", p.texto, tentativas);
+                proximo(d);
+            } else if (++tentativas > 20) {
+                inicioPasso = t - TIMEOUT - Tempo(1);   // desiste no próximo ciclo
+            } else {
+                apertar(p.pino, 100);
+            }
+            break;
+        case Passo::ESPERA:
+            livreEm = t + milliseconds(p.ms);
+            proximo(nullptr);
+            break;
+        case Passo::MARCA:
+            if (!maquina::janela().aberta) maquina::abrir();
+            else                           maquina::fechar();
+            snprintf(d, sizeof(d), "-- %s --", p.texto);
+            proximo(d);
+            break;
+    }
+}
+
+static void montarRoteiro() {
+    typedef Passo P;
+    const int volumes[3] = { 2, 1, 3 };
+    const int jogX[3]    = { 300, 500, 700 };   // ms com X- apertado a partir da coleta
+
+    // Referenciamento
+    roteiro.push_back({ P::TELA,   ">Referenciamento", NC, 0 });
+    roteiro.push_back({ P::APERTA, "enter", BTN_ENTER, 0 });
+    roteiro.push_back({ P::TELA,   "Referenciando", NC, 0 });
+    roteiro.push_back({ P::TELA,   "MENU PRINCIPAL", NC, 0 });
+    // Submenu Pipetadora
+    roteiro.push_back({ P::ATE,    ">Pipetadora", BTN_XDWN, 0 });
+    roteiro.push_back({ P::APERTA, "enter", BTN_ENTER, 0 });
+    roteiro.push_back({ P::TELA,   "PIPETADORA", NC, 0 });
+    // Coleta: X-, Y+ e desce o Z
+    roteiro.push_back({ P::ATE,    ">Config Coleta", BTN_XDWN, 0 });
+    roteiro.push_back({ P::APERTA, "enter", BTN_ENTER, 0 });
+    roteiro.push_back({ P::TELA,   "Posicione e Enter", NC, 0 });
+    roteiro.push_back({ P::SEGURA, "X-", BTN_XDWN, 800 });
+    roteiro.push_back({ P::SEGURA, "Y+", BTN_YUP, 600 });
+    roteiro.push_back({ P::APERTA, "seletor", SWITCH_PIN, 0 });
+    roteiro.push_back({ P::TELA,   "Z/Y", NC, 0 });
+    roteiro.push_back({ P::SEGURA, "Z-", BTN_XDWN, 1500 });
+    roteiro.push_back({ P::APERTA, "seletor", SWITCH_PIN, 0 });
+    roteiro.push_back({ P::TELA,   "X/Y", NC, 0 });
+    roteiro.push_back({ P::APERTA, "enter", BTN_ENTER, 0 });
+    roteiro.push_back({ P::TELA,   "Coleta Salvo", NC, 0 });
+    roteiro.push_back({ P::TELA,   "PIPETADORA", NC, 0 });
+    // Três pontos de solta
+    roteiro.push_back({ P::ATE,    ">Config Solta", BTN_XDWN, 0 });
+    roteiro.push_back({ P::APERTA, "enter", BTN_ENTER, 0 });
+    roteiro.push_back({ P::TELA,   "Qtd Solta:", NC, 0 });
+    roteiro.push_back({ P::ATE,    "Qtd Solta:3", BTN_XUP, 0 });
+    roteiro.push_back({ P::APERTA, "enter", BTN_ENTER, 0 });
+    static char telas[3][2][24];
+    for (int i = 0; i < 3; ++i) {
+        snprintf(telas[i][0], sizeof(telas[i][0]), "Mov PtoS %d", i + 1);
+        snprintf(telas[i][1], sizeof(telas[i][1]), "Vol Pto%d:%d mL", i + 1, volumes[i]);
+        roteiro.push_back({ P::TELA,   telas[i][0], NC, 0 });
+        roteiro.push_back({ P::SEGURA, "X-", BTN_XDWN, jogX[i] });
+        roteiro.push_back({ P::SEGURA, "Y+", BTN_YUP, 400 });
+        roteiro.push_back({ P::APERTA, "enter", BTN_ENTER, 0 });
+        roteiro.push_back({ P::TELA,   "Vol Pto", NC, 0 });
+        roteiro.push_back({ P::ATE,    telas[i][1], BTN_XUP, 0 });
+        roteiro.push_back({ P::APERTA, "enter", BTN_ENTER, 0 });
+    }
+    roteiro.push_back({ P::TELA,   "PIPETADORA", NC, 0 });
+    // Pipetagem automática
+    roteiro.push_back({ P::ATE,    ">Iniciar", BTN_XDWN, 0 });
+    roteiro.push_back({ P::MARCA,  "pipetagem", NC, 0 });
+    roteiro.push_back({ P::APERTA, "enter", BTN_ENTER, 0 });
+    roteiro.push_back({ P::TELA,   "Concluido", NC, 0 });
+    roteiro.push_back({ P::MARCA,  "fim da pipetagem", NC, 0 });
+    roteiro.push_back({ P::TELA,   "MENU PRINCIPAL", NC, 0 });
+}
+
+//======================================================================
+// Relatório
+//======================================================================
+
+static void relatorio(int codigo, double real) {
+    Tempo total = sim::agora();
+    printf("\n== Resultado: %s (codigo %d) em %.3f s virtuais, %.2f s reais (x%.0f) ==\n",
+           sim::motivo(), codigo, seg(total), real, real > 0 ? seg(total) / real : 0.0);
+
+    printf("\n== Pipetagem ==\n");
+    const maquina::Janela& j = maquina::janela();
+    const auto& acionamentos = j.acionamentos;
+    Tempo janela = j.duracao();
+    if (janela > Tempo(0)) {
+        // acionamentos alternam aspirar (coleta) e dispensar (poço); o ciclo vai de uma aspiração à seguinte
+        struct Poco { float x, y; int ciclos; Tempo soma, minimo, maximo; };
+        std::vector<Poco> pocos;
+        int ciclos = 0;
+        for (size_t i = 0; i + 1 < acionamentos.size(); i += 2) {
+            const maquina::Acionamento& disp = acionamentos[i + 1];
+            Tempo fim = (i + 2 < acionamentos.size()) ? acionamentos[i + 2].inicio : j.fim;
+            Tempo ciclo = fim - acionamentos[i].inicio;
+            size_t k = 0;
+            while (k < pocos.size() && (fabsf(pocos[k].x - disp.mm[0]) > 0.5f || fabsf(pocos[k].y - disp.mm[1]) > 0.5f)) ++k;
+            if (k == pocos.size()) pocos.push_back({ disp.mm[0], disp.mm[1], 0, Tempo(0), Tempo::max(), Tempo(0) });
+            Poco& p = pocos[k];
+            p.ciclos++;
+            p.soma += ciclo;
+            p.minimo = std::min(p.minimo, ciclo);
+            p.maximo = std::max(p.maximo, ciclo);
+            ++ciclos;
+        }
+        printf("  duracao %.3f s, %d ciclos, %.1f ciclos/h\n", seg(janela), ciclos, ciclos * 3600.0 / seg(janela));
+        printf("  poco  X(mm)   Y(mm)   ciclos  medio(s)  min(s)  max(s)\n");
+        for (size_t k = 0; k < pocos.size(); ++k) {
+            const auto& p = pocos[k];
+            printf("  %4zu %7.1f %7.1f %8d %9.3f %7.3f %7.3f\n", k + 1, p.x, p.y, p.ciclos,
+                   seg(p.soma) / p.ciclos, seg(p.minimo), seg(p.maximo));
+        }
+        printf("  eixos em movimento %.3f s, parados %.3f s (%.0f%%)\n",
+               seg(j.emMovimento), seg(janela - j.emMovimento), 100.0 * seg(janela - j.emMovimento) / seg(janela));
+    } else {
+        printf("  nao executada\n");
+    }
+
+    printf("\n== Eixos ==\n");
+    for (const maquina::Eixo& e : maquina::eixos) {
+        printf("  %s  pos %7.1f mm  %ld passos  %ld com driver desligado  %ld alem do fim de curso\n",
+               e.nome, e.pos / U_POR_MM, e.passos, e.desabilitado, e.alemDoFim);
+    }
+    if (maquina::saltosZ()) printf("  Z: %ld trocas de bobina invalidas\n", maquina::saltosZ());
+
+    printf("\n== CPU ==\n");
+    printf("  ociosa %.3f s (%.1f%%)\n", seg(sim::ociosa()), 100.0 * seg(sim::ociosa()) / seg(total));
+    printf("  thread               prio  ocupada(s)  dormindo(s)  esperando(s)\n");
+    for (const auto& t : sim::tarefas()) {
+        printf("  %-20s %4d %11.3f %12.3f %13.3f\n", t.nome.c_str(), t.prioridade,
+               seg(t.ocupada), seg(t.dormindo), seg(t.esperando));
+    }
+
+    printf("\n== sleep_for ==\n");
+    printf("  local                  thread               vezes    total(s)\n");
+    for (const auto& s : sim::sonos()) {
+        printf("  %-22s %-20s %6ld %10.3f\n", s.local.c_str(), s.tarefa.c_str(), s.vezes, seg(s.total));
+    }
+
+    // chamadas exatas; o corpo das ISR não consome tempo virtual, então as
+    // durações só contam esperas modeladas (I2C, sleep dentro do escopo)
+    printf("\n== Perfil ==\n");
+    Perfil_Dump();
+
+    eventos::Despejo d;
+    eventos::capturar(d);
+    long porTipo[8] = {};
+    for (const Registro_Evento& e : d.eventos) porTipo[e.tipo & 7]++;
+    printf("\n== Registro ==\n");
+    printf("  %lu eventos gravados, %zu no buffer, %ld perdidos na leitura\n", d.total, d.eventos.size(), d.perdidas);
+    for (int t = REG_MOV_INICIO; t <= REG_FASE_FIM; ++t) printf("  %-12s %6ld\n", eventos::nomeTipo(uint8_t(t)), porTipo[t]);
+
+    const sim::EstatI2c& b = sim::i2c();
+    printf("\n== LCD (I2C) ==\n");
+    printf("  %ld transacoes, %ld bytes, barramento ocupado %.3f s (%.1f%%)\n",
+           b.transacoes, b.bytes, seg(b.ocupado), 100.0 * seg(b.ocupado) / seg(total));
+    mostrarTela();
+}
+
+int bancada(int argc, char** argv);   // bancada.cpp
+int gcode(int argc, char** argv, void (*gravarRegistro)(const char*));   // gcode.cpp
+int verificacao(int argc, char** argv);   // verificar.cpp
+
+// Bordas capturadas na placa e copiadas do console
+static int analisarDespejo(const char* arquivo) {
+    FILE* f = fopen(arquivo, "r");
+    passos::Captura c;
+    if (!f || !passos::ler(f, c)) {
+        fprintf(stderr, "%s: sem a linha #passos de Pipetadora_TraceDump\n", arquivo);
+        if (f) fclose(f);
+        return 5;
+    }
+    fclose(f);
+    passos::Eixo eixos[3];
+    passos::analisar(c, eixos);
+    passos::imprimir(eixos, c.perdidas, 0);
+    printf("\n");
+    return 0;
+}
+
+// Despejo do registro de eventos copiado do console da placa
+static int decodificarRegistro(const char* arquivo, const char* formato) {
+    FILE* f = fopen(arquivo, "r");
+    eventos::Despejo d;
+    if (!f || !eventos::ler(f, d)) {
+        fprintf(stderr, "%s: sem a linha #registro de Registro_Dump\n", arquivo);
+        if (f) fclose(f);
+        return 5;
+    }
+    fclose(f);
+    if (strcmp(formato, "chrome") == 0) eventos::chrome(stdout, d);
+    else                                eventos::csv(stdout, d);
+    return 0;
+}
+
+// Registro do firmware ao fim do cenário; .json → trace do Chrome, senão CSV
+static void gravarRegistro(const char* arquivo) {
+    FILE* f = fopen(arquivo, "w");
+    if (!f) { fprintf(stderr, "%s: nao foi possivel criar\n", arquivo); return; }
+    eventos::Despejo d;
+    eventos::capturar(d);
+    size_t n = strlen(arquivo);
+    if (n >= 5 && strcmp(arquivo + n - 5, ".json") == 0) eventos::chrome(f, d);
+    else                                                 eventos::csv(f, d);
+    fclose(f);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "bancada") == 0) {
+        int codigo = bancada(argc - 2, argv + 2);
+        fflush(stdout);
+        std::_Exit(codigo);
+    }
+    if (argc > 2 && strcmp(argv[1], "passos") == 0) {
+        int codigo = analisarDespejo(argv[2]);
+        fflush(stdout);
+        std::_Exit(codigo);
+    }
+    if (argc > 2 && strcmp(argv[1], "registro") == 0) {
+        int codigo = decodificarRegistro(argv[2], argc > 3 ? argv[3] : "csv");
+        fflush(stdout);
+        std::_Exit(codigo);
+    }
+    if (argc > 1 && strcmp(argv[1], "gcode") == 0) {
+        int codigo = gcode(argc - 2, argv + 2, gravarRegistro);
+        fflush(stdout);
+        std::_Exit(codigo);
+    }
+    if (argc > 1 && strcmp(argv[1], "verificar") == 0) {
+        int codigo = verificacao(argc - 2, argv + 2);
+        fflush(stdout);
+        std::_Exit(codigo);
+    }
+    double limite = 900.0;
+    const char* saidaRegistro = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--registro") == 0 && i + 1 < argc) saidaRegistro = argv[++i];
+        else                                                    limite = atof(argv[i]);
+    }
+
+    maquina::instalar(true);
+    montarRoteiro();
+    sim::agendar(Tempo(0), verificar);
+
+    printf("== Linha do tempo ==\n");
+    sim::iniciar([] { app_main(); });
+    auto inicio = steady_clock::now();
+    int codigo = sim::executar(duration_cast<Tempo>(duration<double>(limite)));
+    double real = duration<double>(steady_clock::now() - inicio).count();
+
+    relatorio(codigo, real);
+    if (saidaRegistro) gravarRegistro(saidaRegistro);
+    fflush(stdout);
+    std::_Exit(codigo);
+}
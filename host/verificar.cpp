@@ -0,0 +1,638 @@
+// verificar.cpp (host)
+// Verificações de regressão: cada uma mede no simulador um número de
+// desempenho do firmware e o compara com uma referência medida na mesma
+// execução (a implementação anterior, o eixo sozinho, a tela redesenhada
+// inteira) ou com o limite que o próprio firmware pede, nunca com o valor de
+// uma versão. Uma mudança que perca o ganho faz a verificação falhar e o
+// código de saída ser 1.
+//
+//   simulador verificar [nome...]     (padrão: todas)
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "maquina.h"
+#include "Menu.h"
+#include "Pipetadora.h"
+#include "pinos.h"
+#include "Protocolo.h"
+#include "StepEngine.h"
+#include "TextLCD.h"
+#include "TextLCD_Fixed.h"
+
+using namespace std::chrono;
+using namespace std::chrono_literals;
+using sim::Tempo;
+
+static double seg(Tempo t) { return t.count() / 1e6; }
+
+static int medidas = 0, falhas = 0;
+
+// valor <= limite (op '<') ou valor >= limite (op '>')
+static void conferir(const char* medida, double valor, const char* unidade, char op, double limite) {
+    bool ok = (op == '<') ? valor <= limite : valor >= limite;
+    ++medidas;
+    if (!ok) ++falhas;
+    printf("  %-42s %11.2f %-9s %s %11.2f  %s\n", medida, valor, unidade,
+           op == '<' ? "<=" : ">=", limite, ok ? "ok" : "FALHOU");
+}
+
+// Ponto de partida de toda verificação: 12,5 mm dos fins de curso do homing
+static void repousar() {
+    Pipetadora_MoveTo(2, -1000);
+    Pipetadora_MoveTo(0, -1000);
+    Pipetadora_MoveTo(1, 1000);
+}
+
+//======================================================================
+// Gerador de passos
+//======================================================================
+
+// Bordas de subida do STEP (X, Y) e trocas de bobina (Z), escritas em pinos
+// por entrada de ISR de timer e o Z mais baixo numa borda do X ou do Y
+struct Bordas {
+    Tempo ultima[3]   = { Tempo(-1), Tempo(-1), Tempo(-1) };
+    Tempo menor[3]    = { Tempo::max(), Tempo::max(), Tempo::max() };
+    long  eventos     = 0;      // toda escrita em STEP ou nas bobinas
+    long  isr         = -1;     // disparo de timer das escritas contadas em porIsr
+    int   porIsr      = 0;
+    int   maxPorIsr   = 0;
+    int32_t zComXY    = INT32_MAX;
+    bool  ligado      = false;
+
+    void escrita() {
+        if (!sim::emIsr()) return;
+        long d = sim::timers().disparos;
+        if (d != isr) { isr = d; porIsr = 0; }
+        maxPorIsr = std::max(maxPorIsr, ++porIsr);
+    }
+    void passo(int id) {
+        Tempo t = sim::agora();
+        if (ultima[id] >= Tempo(0)) menor[id] = std::min(menor[id], t - ultima[id]);
+        ultima[id] = t;
+        if (id < 2) zComXY = std::min(zComXY, maquina::eixos[2].pos);
+    }
+    double hzPico(int id) const { return menor[id] == Tempo::max() ? 0.0 : 1e6 / menor[id].count(); }
+};
+static Bordas bordas;
+
+static void observarPinos() {
+    sim::aoEscrever([](PinName p, int v) {
+        if (!bordas.ligado) return;
+        bordas.escrita();
+        if (p == MOTOR_X || p == MOTOR_Y) {
+            ++bordas.eventos;
+            if (v) bordas.passo(p == MOTOR_X ? 0 : 1);
+        }
+    });
+    sim::aoEscreverBarramento([](const PinName* p, int n, int v) {
+        if (!bordas.ligado || n != 4 || p[0] != Z_A1 || v == 0) return;
+        bordas.escrita();
+        ++bordas.eventos;
+        bordas.passo(2);
+    });
+}
+
+// Os três eixos juntos na velocidade máxima: cada eixo deve manter o passo de
+// pico que tem sozinho (período mínimo da tabela), com no máximo uma entrada de
+// ISR por borda. O timer só é desarmado quando um movimento novo parte antes do
+// prazo armado, nunca entre bordas
+static void verificarPassos() {
+    static const char* nomes[3] = { "X", "Y", "Z" };
+    double sozinho[3];
+    for (int id = 0; id < 3; ++id) {
+        bordas = Bordas();
+        bordas.ligado = true;
+        int alvo = (id == 0) ? -16000 : (id == 1) ? 16000 : -4000;
+        Pipetadora_MoveTo(id, alvo);
+        bordas.ligado = false;
+        sozinho[id] = bordas.hzPico(id);
+        repousar();
+    }
+
+    bordas = Bordas();
+    sim::EstatTimer antes = sim::timers();
+    bordas.ligado = true;
+    Pipetadora_Handle h = Pipetadora_MoveToAsync(0, -16000, NULL);
+    h |= Pipetadora_MoveToAsync(1, 16000, NULL);
+    h |= Pipetadora_MoveToAsync(2, -4000, NULL);
+    bool ok = Pipetadora_Wait(h);
+    bordas.ligado = false;
+    const sim::EstatTimer& depois = sim::timers();
+
+    char medida[64];
+    for (int id = 0; id < 3; ++id) {
+        snprintf(medida, sizeof(medida), "%s pico com os tres eixos / sozinho", nomes[id]);
+        conferir(medida, 100.0 * bordas.hzPico(id) / sozinho[id], "%", '>', 100.0);
+    }
+    printf("  pico com os tres eixos: X %.0f, Y %.0f, Z %.0f passos/s\n",
+           bordas.hzPico(0), bordas.hzPico(1), bordas.hzPico(2));
+    conferir("entradas de ISR por borda", double(depois.disparos - antes.disparos) / bordas.eventos, "", '<', 1.0);
+    conferir("timer desarmado (3 partidas)", double(depois.cancelados - antes.cancelados), "vezes", '<', 1.0);
+    conferir("pior ISR: escritas em pinos (uma por eixo)", bordas.maxPorIsr, "escritas", '<', 3.0);
+    conferir("movimento concluido", ok ? 1.0 : 0.0, "", '>', 1.0);
+}
+
+//======================================================================
+// Rampa trapezoidal
+//======================================================================
+
+// Rampa anterior do X (uma borda do STEP por ISR do Ticker): parte de 1000 us
+// e encurta 25 us a cada 25 bordas até 175 us, sem desacelerar no alvo
+static Tempo tempoRampaLinear(int unidades) {
+    int64_t total = 0;
+    for (int k = 0; k < unidades; ++k) total += std::max(175, 1000 - 25 * (k / 25));
+    return Tempo(total);
+}
+
+// MoveTo do X com a tabela de aceleração constante contra a rampa linear
+// anterior, do repouso ao repouso e parando exatamente no alvo
+static void verificarRampa() {
+    static const int mm[] = { 5, 20, 100 };
+    char medida[64];
+    for (size_t i = 0; i < sizeof(mm) / sizeof(mm[0]); ++i) {
+        int unidades = mm[i] * 80;
+        int origem = Pipetadora_GetPositionSteps(0);
+        Tempo inicio = sim::agora();
+        Pipetadora_MoveTo(0, origem - unidades);
+        Tempo novo = sim::agora() - inicio;
+        Tempo antigo = tempoRampaLinear(unidades);
+        snprintf(medida, sizeof(medida), "X %3d mm: tempo (limite: rampa linear)", mm[i]);
+        conferir(medida, novo.count() / 1e3, "ms", '<', antigo.count() / 1e3);
+        snprintf(medida, sizeof(medida), "X %3d mm: erro de posicao no fim", mm[i]);
+        conferir(medida, abs(Pipetadora_GetPositionSteps(0) - (origem - unidades)), "unidades", '<', 0.0);
+    }
+}
+
+//======================================================================
+// Sobreposição do Z com o XY
+//======================================================================
+
+// Um ciclo de aspirar/dispensar como a fila o executava antes (Z até o topo e
+// XY só com o Z parado) contra QueueTravel com altura segura. Os dois partem do
+// Z no topo sobre o ponto de soltar e terminam lá; o Z nunca fica abaixo da
+// altura segura enquanto o X ou o Y dá passo
+static const int coleta[3] = { -4000, 4000, -1600 };
+static const int solta[3]  = { -12000, 9000, -1800 };
+static const int zSeguro   = -1600 + 800;     // ponto mais alto + FOLGA_Z do Protocolo
+
+static Tempo cicloFila(bool sobrepor) {
+    Pipetadora_MoveTo(2, 0);
+    Pipetadora_MoveTo(0, solta[0]);
+    Pipetadora_MoveTo(1, solta[1]);
+    Pipetadora_SetPhase(PONTEIRA_VAZIA);
+    Pipetadora_SetSafeHeight(zSeguro);
+    Tempo inicio = sim::agora();
+    for (const int* p : { coleta, solta }) {
+        if (sobrepor) {
+            Pipetadora_QueueTravel(p[0], p[1], p[2]);
+        } else {
+            Pipetadora_QueueLinear(p[0], p[1]);
+            Pipetadora_QueueMoveZ(p[2]);
+        }
+        Pipetadora_QueueValve();
+        Pipetadora_QueueDwell(p == coleta ? 2000 : 1200);
+        if (!sobrepor) Pipetadora_QueueMoveZ(0);
+        Pipetadora_SetPhase(p == coleta ? PONTEIRA_CHEIA : PONTEIRA_VAZIA);
+    }
+    if (sobrepor) Pipetadora_QueueMoveZ(0);
+    bordas = Bordas();
+    bordas.ligado = true;
+    bool ok = Pipetadora_RunQueue();
+    bordas.ligado = false;
+    conferir(sobrepor ? "ciclo com sobreposicao concluido" : "ciclo sequencial concluido", ok ? 1.0 : 0.0, "", '>', 1.0);
+    return sim::agora() - inicio;
+}
+
+static void verificarSobreposicao() {
+    Tempo sequencial = cicloFila(false);
+    Tempo sobreposto = cicloFila(true);
+    int32_t zMin = bordas.zComXY;
+    printf("  ciclo sequencial %.3f s, com sobreposicao %.3f s; Z mais baixo com XY andando %d (seguro %d)\n",
+           seg(sequencial), seg(sobreposto), int(zMin), zSeguro);
+    conferir("ciclo com sobreposicao (limite: sequencial)", seg(sobreposto), "s", '<', seg(sequencial));
+    conferir("Z abaixo da altura segura com XY andando", std::max(0, zSeguro - int(zMin)), "unidades", '<', 0.0);
+}
+
+//======================================================================
+// Tráfego do LCD contra o movimento
+//======================================================================
+
+// Thread da interface redesenhando a tela inteira sem parar, sem framebuffer
+// (toda escrita vai ao barramento); termina quando martelar volta a false
+static volatile bool martelar = false;
+static long          telas    = 0;
+
+static TextLCD_I2C& lcdTeste();
+
+static void martelarLcd() {
+    TextLCD_I2C& lcd = lcdTeste();
+    lcd.setFrameBuffer(false);
+    while (martelar) {
+        lcd.cls();
+        for (int r = 0; r < 4; ++r) {
+            lcd.locate(0, r);
+            lcd.printf("Tela %6ld linha %d", telas, r);
+        }
+        ++telas;
+    }
+}
+
+struct Execucao {
+    bool  ok;
+    Tempo duracao;                // do envio ao FIM (consulta a cada 10 ms)
+    Tempo emMovimento;
+    std::vector<Tempo> valvula;   // acionamentos, desde o envio do comando
+    long  bytes;
+    Tempo barramento;
+};
+
+// Um comando PIPETAR pela thread de movimento, com a interface ociosa
+// (consulta a cada 10 ms) ou martelando o LCD
+static Execucao pipetarComando(bool comLcd) {
+    static const Ponto coleta   = { { -4000, 4000, -1600 } };
+    static const Ponto solta[2] = { { { -12000, 9000, -1800 } }, { { -8000, 12000, -1700 } } };
+    static const int   volume[2] = { 2, 1 };
+    static Thread* interface = nullptr;
+    Pipetadora_MoveTo(2, 0);
+    repousar();
+    if (comLcd) {
+        martelar = true;
+        interface = new Thread(osPriorityNormal, 4096, nullptr, "interface");   // sem join no host
+        interface->start(callback(martelarLcd));
+    }
+    sim::EstatI2c i2cAntes = sim::i2c();
+    maquina::abrir();
+    Comando c = { Comando::PIPETAR, &coleta, solta, volume, 2 };
+    Execucao e;
+    e.ok = Protocolo_Send(c);
+    Status s;
+    while (e.ok) {
+        if (!Protocolo_Poll(s)) { ThisThread::sleep_for(10ms); continue; }
+        if (s.tipo == Status::FIM) { e.ok = s.ok; break; }
+    }
+    maquina::fechar();
+    e.bytes = sim::i2c().bytes - i2cAntes.bytes;
+    e.barramento = sim::i2c().ocupado - i2cAntes.ocupado;
+    martelar = false;
+    ThisThread::sleep_for(50ms);   // a interface termina a tela em curso
+    const maquina::Janela& j = maquina::janela();
+    e.duracao = j.duracao();
+    e.emMovimento = j.emMovimento;
+    for (const maquina::Acionamento& a : j.acionamentos) e.valvula.push_back(a.inicio - j.inicio);
+    return e;
+}
+
+// A interface presa no LCD não atrasa o movimento: com o barramento I2C ocupado
+// o tempo todo, os acionamentos da válvula caem nos mesmos instantes e o tempo
+// em movimento é o mesmo do comando com a interface ociosa
+static void verificarLcd() {
+    static bool iniciado = false;
+    if (!iniciado) { Protocolo_Start(); iniciado = true; }
+    Execucao ociosa = pipetarComando(false);
+    Execucao ocupada = pipetarComando(true);
+    Tempo desvio(0);
+    bool mesmos = ociosa.valvula.size() == ocupada.valvula.size();
+    for (size_t i = 0; mesmos && i < ociosa.valvula.size(); ++i) {
+        desvio = std::max(desvio, ocupada.valvula[i] > ociosa.valvula[i] ? ocupada.valvula[i] - ociosa.valvula[i]
+                                                                          : ociosa.valvula[i] - ocupada.valvula[i]);
+    }
+    Tempo movimento = std::max(ocupada.emMovimento, ociosa.emMovimento) - std::min(ocupada.emMovimento, ociosa.emMovimento);
+    printf("  %ld telas, %ld bytes no I2C em %.3f s; %zu acionamentos da valvula\n",
+           telas, ocupada.bytes, seg(ocupada.duracao), ocupada.valvula.size());
+    conferir("comandos concluidos", (ociosa.ok && ocupada.ok) ? 1.0 : 0.0, "", '>', 1.0);
+    conferir("barramento I2C ocupado pela interface", 100.0 * seg(ocupada.barramento) / seg(ocupada.duracao),
+             "%", '>', 99.0);
+    conferir("acionamentos da valvula (ocioso - ocupado)", double(ociosa.valvula.size()) - ocupada.valvula.size(),
+             "", '<', 0.0);
+    conferir("maior desvio de um acionamento", desvio.count(), "us", '<', 0.0);
+    conferir("diferenca do tempo em movimento", movimento.count(), "us", '<', 0.0);
+}
+
+//======================================================================
+// Tráfego do LCD no I2C
+//======================================================================
+
+extern const MenuDef menuPrincipal;   // main.cpp
+
+// LCD 20x4 do firmware (PCF8574 em 0x7E) num I2C próprio, com a configuração
+// padrão do TextLCD_Config.h
+static TextLCD_I2C& lcdTeste() {
+    static I2C i2c(D14, D15);
+    static TextLCD_I2C lcd(&i2c, 0x7E, TextLCD::LCD20x4);
+    return lcd;
+}
+
+struct Trafego {
+    long  bytes;        // endereço incluído
+    long  transacoes;
+    Tempo barramento;
+    long  dados;        // escritas na DDRAM/CGRAM que o controlador executou
+    long  enderecos;    // comandos de endereço que o controlador recebeu
+};
+
+// Tráfego de desenhar(), da fila de quadros do I2C vazia até ela esvaziar de novo
+template <typename F>
+static Trafego trafego(F desenhar) {
+    ThisThread::sleep_for(200ms);
+    sim::EstatI2c antes = sim::i2c();
+    sim::EstatLcd lcdAntes = sim::lcd();
+    desenhar();
+    ThisThread::sleep_for(200ms);
+    const sim::EstatI2c& depois = sim::i2c();
+    const sim::EstatLcd& lcdDepois = sim::lcd();
+    return { depois.bytes - antes.bytes, depois.transacoes - antes.transacoes, depois.ocupado - antes.ocupado,
+             lcdDepois.dados - lcdAntes.dados, lcdDepois.enderecos - lcdAntes.enderecos };
+}
+
+static void mostrarTrafego(const char* nome, const Trafego& t) {
+    printf("  %s: %ld bytes, %ld transacoes, %.1f ms de barramento; %ld caracteres, %ld enderecos\n", nome,
+           t.bytes, t.transacoes, t.barramento.count() / 1e3, t.dados, t.enderecos);
+}
+
+// parte em % de todo, com limite também em %
+static void conferirFracao(const char* medida, long parte, long todo, double limite) {
+    conferir(medida, 100.0 * parte / std::max(todo, 1L), "%", '<', limite);
+}
+
+// Menu redesenhado inteiro (cls e as quatro linhas), como a interface fazia
+// antes do Menu incremental
+static void telaMenu(TextLCD_I2C& lcd, const MenuDef& m, int cursor) {
+    lcd.cls();
+    lcd.locate(m.colTitulo, 0);
+    lcd.printf("%s", m.titulo);
+    for (int r = 1; r < 4 && r <= m.num; ++r) {
+        lcd.locate(0, r);
+        lcd.printf("%c%s", r - 1 == cursor ? '>' : ' ', m.itens[r - 1].texto);
+    }
+    lcd.flush();
+}
+
+// Framebuffer: mover o cursor redesenhando a tela inteira só envia as células
+// que mudaram (os dois '>'); sem framebuffer, a mesma tela vai inteira
+static void verificarQuadro() {
+    TextLCD_I2C& lcd = lcdTeste();
+    lcd.setFrameBuffer(false);
+    telaMenu(lcd, menuPrincipal, 0);
+    Trafego direto = trafego([&] { telaMenu(lcd, menuPrincipal, 1); });
+    lcd.setFrameBuffer(true);
+    telaMenu(lcd, menuPrincipal, 0);
+    Trafego quadro = trafego([&] { telaMenu(lcd, menuPrincipal, 1); });
+    lcd.setFrameBuffer(false);
+    mostrarTrafego("cursor do menu sem framebuffer", direto);
+    mostrarTrafego("cursor do menu com framebuffer", quadro);
+    conferirFracao("bytes com framebuffer / sem", quadro.bytes, direto.bytes, 20.0);
+    conferir("transacoes (limite: sem framebuffer)", quadro.transacoes, "", '<', direto.transacoes);
+}
+
+// Sem framebuffer: o comando de endereço só sai quando o contador de endereço
+// do controlador não chega sozinho à próxima célula. Uma linha de 20
+// caracteres é um endereço no início, 20 dados e um endereço na virada para a
+// linha seguinte; a tela inteira, um endereço por linha mais o do cls
+static void verificarLinha() {
+    TextLCD_I2C& lcd = lcdTeste();
+    lcd.setFrameBuffer(false);
+    lcd.cls();
+    Trafego linha = trafego([&] {
+        lcd.locate(0, 1);
+        lcd.printf("Vol Pto%d:%3d mL     ", 1, 2);
+    });
+    bool escrita = sim::linhaLcd(1) == "Vol Pto1:  2 mL     ";
+    Trafego tela = trafego([&] { telaMenu(lcd, menuPrincipal, 2); });
+    mostrarTrafego("printf de 20 caracteres", linha);
+    mostrarTrafego("menu principal sem framebuffer", tela);
+    conferir("printf de 20 caracteres: caracteres", linha.dados, "", '>', 20.0);
+    conferir("printf de 20 caracteres: enderecos", linha.enderecos, "", '<', 2.0);
+    conferir("linha no display", escrita ? 1.0 : 0.0, "", '>', 1.0);
+    conferir("menu principal: enderecos (cls e linhas)", tela.enderecos, "", '<', 5.0);
+}
+
+// Escrita em bloco: com o framebuffer, a tela 20x4 inteira trocada vai em
+// rajadas de quadros (endereço, RS e os caracteres de cada linha), sem uma
+// transação por caractere. Um caractere custa 4 quadros (E alto e baixo de
+// cada nibble); com o RS reenviado a cada um seriam 5
+static void verificarRajada() {
+    TextLCD_I2C& lcd = lcdTeste();
+    lcd.setFrameBuffer(false);
+    lcd.setFrameBuffer(true);
+    Trafego tela = trafego([&] {
+        for (int r = 0; r < 4; ++r) {
+            lcd.locate(0, r);
+            lcd.printf("Linha %d: 0123456789!", r);
+        }
+        lcd.flush();
+    });
+    lcd.setFrameBuffer(false);
+    mostrarTrafego("tela 20x4 inteira com framebuffer", tela);
+    conferir("caracteres", tela.dados, "", '>', 80.0);
+    conferir("transacoes (uma por linha)", tela.transacoes, "", '<', 4.0);
+    conferir("bytes por caractere (RS em cada um: 5)", double(tela.bytes) / tela.dados, "bytes", '<', 4.5);
+    conferir("ultima linha no display", sim::linhaLcd(3) == "Linha 3: 0123456789!" ? 1.0 : 0.0, "", '>', 1.0);
+}
+
+// Textos do submenu da Pipetadora: 4 itens em 3 linhas (as ações não são chamadas)
+static const MenuItem itensRolagem[] = {
+    { "Config Coleta", nullptr },
+    { "Config Solta",  nullptr },
+    { "Reset Mem",     nullptr },
+    { "Iniciar",       nullptr },
+};
+static const MenuDef menuRolagem = { "PIPETADORA", 3, itensRolagem, MENU_NUM(itensRolagem), nullptr };
+
+// Menu incremental: um passo do cursor dentro da janela reescreve só as duas
+// células do '>' e uma rolagem só as linhas cujo texto muda, com ou sem
+// framebuffer, contra a tela redesenhada inteira como a interface fazia antes
+static void verificarMenu() {
+    TextLCD_I2C& lcd = lcdTeste();
+    lcd.setFrameBuffer(false);
+    Trafego redesenho = trafego([&] { telaMenu(lcd, menuRolagem, 1); });
+    mostrarTrafego("cls e menu inteiro sem framebuffer", redesenho);
+    char medida[64];
+    for (int fb = 0; fb < 2; ++fb) {
+        lcd.setFrameBuffer(fb != 0);
+        Menu menu(lcd);
+        menu.open(menuRolagem, 0);
+        Trafego passo = trafego([&] { menu.down(); });
+        bool cursor = sim::linhaLcd(2)[0] == '>';
+        menu.down();
+        Trafego rolagem = trafego([&] { menu.down(); });
+        std::string ultimo = std::string(">") + menuRolagem.itens[3].texto;
+        ultimo.resize(20, ' ');
+        bool janela = sim::linhaLcd(3) == ultimo;
+        snprintf(medida, sizeof(medida), "passo do cursor %s framebuffer", fb ? "com" : "sem");
+        mostrarTrafego(medida, passo);
+        snprintf(medida, sizeof(medida), "passo %s framebuffer / redesenho", fb ? "com" : "sem");
+        conferirFracao(medida, passo.bytes, redesenho.bytes, 20.0);
+        snprintf(medida, sizeof(medida), "rolagem %s framebuffer", fb ? "com" : "sem");
+        mostrarTrafego(medida, rolagem);
+        snprintf(medida, sizeof(medida), "rolagem %s framebuffer / redesenho", fb ? "com" : "sem");
+        conferirFracao(medida, rolagem.bytes, redesenho.bytes, 75.0);   // 3 das 4 linhas
+        conferir("cursor e janela no display", (cursor && janela) ? 1.0 : 0.0, "", '>', 1.0);
+    }
+    lcd.setFrameBuffer(false);
+}
+
+// TextLCD_PCF8574 (TextLCD_Fixed.h): a mesma tela desenhada pelo driver de
+// tipo fixo e pelo TextLCD_I2C sem framebuffer, no mesmo módulo em 0x7E. O
+// texto sai do mesmo formatador (_lcd_vformat) e cada trecho de linha vai
+// numa escrita só, com o endereço apenas quando o contador do controlador não
+// chega sozinho à célula
+static void telaFixo(TextLCD_I2C* geral, TextLCD_PCF8574<20, 4>* fixo) {
+    static const char* nomes[4] = { "X", "Y", "Z", "Vol" };
+    for (int r = 0; r < 4; ++r) {
+        if (geral) { geral->locate(0, r); geral->printf("%-3s%7ld %3d%% %04x", nomes[r], -1234L * r, 25 * r, 0xbe + r); }
+        if (fixo)  { fixo->locate(0, r);  fixo->printf("%-3s%7ld %3d%% %04x", nomes[r], -1234L * r, 25 * r, 0xbe + r); }
+    }
+}
+
+static void verificarFixo() {
+    static I2C i2c(D14, D15);
+    static TextLCD_PCF8574<20, 4> fixo(&i2c, 0x7E);
+    TextLCD_I2C& lcd = lcdTeste();
+    lcd.setFrameBuffer(false);
+    lcd.cls();
+    Trafego geral = trafego([&] { telaFixo(&lcd, nullptr); });
+    std::string antes[4];
+    for (int r = 0; r < 4; ++r) antes[r] = sim::linhaLcd(r);
+    fixo.cls();
+    Trafego fixa = trafego([&] { telaFixo(nullptr, &fixo); });
+    bool igual = true;
+    for (int r = 0; r < 4; ++r) igual = igual && sim::linhaLcd(r) == antes[r];
+    lcd.cls();   // o TextLCD_I2C volta a conhecer o contador de endereço
+    mostrarTrafego("tela com o TextLCD_I2C", geral);
+    mostrarTrafego("tela com o TextLCD_PCF8574<20, 4>", fixa);
+    conferir("mesmo texto no display", igual ? 1.0 : 0.0, "", '>', 1.0);
+    conferir("caracteres (limite: TextLCD_I2C)", fixa.dados, "", '>', geral.dados);
+    conferir("enderecos (limite: TextLCD_I2C)", fixa.enderecos, "", '<', geral.enderecos);
+    conferir("bytes (limite: TextLCD_I2C)", fixa.bytes, "", '<', geral.bytes);
+}
+
+//======================================================================
+// Curva S
+//======================================================================
+
+// Velocidade, aceleração e jerk de pico de uma tabela de períodos (us por
+// evento). O período arredondado em us faz a diferença entre eventos seguidos
+// oscilar muito mais que a curva, então as derivadas saem de diferenças
+// divididas sobre eventos separados por pelo menos AMOSTRA: a posição é exata
+// (um evento) e a diferença dividida de ordem k é uma média ponderada da
+// derivada k no intervalo, nunca acima do seu máximo.
+struct Picos { double v = 0, a = 0, j = 0; };
+
+static Picos picosTabela(const uint16_t* tab, int n) {
+    const double AMOSTRA = 0.02;
+    std::vector<double> t(1, 0.0), x(1, 0.0);   // parte do repouso na posição 0
+    double fim = 0;
+    for (int i = 0; i < n; ++i) {
+        fim += tab[i] / 1e6;
+        if (fim - t.back() >= AMOSTRA || i + 1 == n) {
+            t.push_back(fim);
+            x.push_back(i + 1);
+        }
+    }
+    Picos p;
+    for (size_t k = 1; k < t.size(); ++k) {
+        double d1 = (x[k] - x[k - 1]) / (t[k] - t[k - 1]);
+        p.v = std::max(p.v, d1);
+        if (k < 2) continue;
+        double d2 = ((x[k] - x[k - 1]) / (t[k] - t[k - 1]) - (x[k - 1] - x[k - 2]) / (t[k - 1] - t[k - 2]))
+                    / (t[k] - t[k - 2]);
+        p.a = std::max(p.a, fabs(2 * d2));
+        if (k < 3) continue;
+        double d2Ant = ((x[k - 1] - x[k - 2]) / (t[k - 1] - t[k - 2]) - (x[k - 2] - x[k - 3]) / (t[k - 2] - t[k - 3]))
+                       / (t[k - 1] - t[k - 3]);
+        p.j = std::max(p.j, fabs(6 * (d2 - d2Ant) / (t[k] - t[k - 3])));
+    }
+    return p;
+}
+
+// buildSCurve com os limites de cada eixo e fase em percursos curtos, médios e
+// longos: nenhuma tabela passa dos limites pedidos e subida mais descida cabem
+// no percurso
+static void verificarCurvaS() {
+    struct Caso { const char* nome; Pipetadora_Limites l; };
+    static const Caso casos[] = {
+        { "X vazia", {  5700.0f, 40000.0f, 800000.0f } },
+        { "X cheia", {  4000.0f, 15000.0f, 150000.0f } },
+        { "Z vazia", {   666.0f,  4000.0f,  80000.0f } },
+    };
+    static const uint32_t percursos[] = { 100, 1000, 10000 };
+    static uint16_t tab[768];
+    double v = 0, a = 0, j = 0;
+    long excessos = 0;
+    for (const Caso& c : casos) {
+        for (uint32_t eventos : percursos) {
+            int n = StepEngine::buildSCurve(tab, 768, eventos, c.l.vmax, c.l.amax, c.l.jmax);
+            Picos p = picosTabela(tab, n);
+            v = std::max(v, p.v / c.l.vmax);
+            a = std::max(a, p.a / c.l.amax);
+            j = std::max(j, p.j / c.l.jmax);
+            if (2u * n > eventos) ++excessos;
+            printf("  %s, %5u eventos: %3d entradas, pico %6.0f ev/s, %7.0f ev/s2, %8.0f ev/s3\n",
+                   c.nome, eventos, n, p.v, p.a, p.j);
+        }
+    }
+    // folga: período arredondado em us (jerk ~1% acima nas tabelas de X)
+    conferir("velocidade de pico / vmax", 100.0 * v, "%", '<', 100.5);
+    conferir("aceleracao de pico / amax", 100.0 * a, "%", '<', 100.5);
+    conferir("jerk de pico / jmax", 100.0 * j, "%", '<', 102.0);
+    conferir("subida + descida maiores que o percurso", excessos, "tabelas", '<', 0.0);
+}
+
+//======================================================================
+// Execução
+//======================================================================
+
+struct Verificacao {
+    const char* nome;
+    const char* descricao;
+    void      (*rodar)();
+};
+
+static const Verificacao verificacoes[] = {
+    { "passos", "gerador de passos: X, Y e Z juntos na velocidade maxima", verificarPassos },
+    { "rampa",  "rampa trapezoidal do X contra a rampa linear anterior",   verificarRampa },
+    { "curva_s", "limites de velocidade, aceleracao e jerk das curvas S",  verificarCurvaS },
+    { "sobreposicao", "ciclo da fila com o Z sobreposto ao XY contra o sequencial", verificarSobreposicao },
+    { "lcd",     "movimento com a interface martelando o LCD contra a interface ociosa", verificarLcd },
+    { "quadro",  "framebuffer: bytes no I2C para mover o cursor do menu",   verificarQuadro },
+    { "linha",   "bytes no I2C de uma linha e de uma tela sem framebuffer", verificarLinha },
+    { "rajada",  "bytes no I2C da tela 20x4 inteira com framebuffer",     verificarRajada },
+    { "menu",    "bytes no I2C por tecla no menu incremental",             verificarMenu },
+    { "fixo",    "TextLCD_PCF8574 contra o TextLCD_I2C na mesma tela",     verificarFixo },
+};
+
+int verificacao(int argc, char** argv) {
+    std::vector<const Verificacao*> escolhidas;
+    for (int i = 0; i < argc; ++i) {
+        const Verificacao* v = nullptr;
+        for (const Verificacao& x : verificacoes) if (strcmp(x.nome, argv[i]) == 0) v = &x;
+        if (!v) {
+            fprintf(stderr, "verificacao desconhecida: %s (", argv[i]);
+            for (const Verificacao& x : verificacoes) fprintf(stderr, " %s", x.nome);
+            fprintf(stderr, " )\n");
+            return 5;
+        }
+        escolhidas.push_back(v);
+    }
+    if (escolhidas.empty()) for (const Verificacao& x : verificacoes) escolhidas.push_back(&x);
+
+    maquina::instalar(false);
+    observarPinos();
+    sim::iniciar([escolhidas] {
+        Pipetadora_InitMotors();
+        Pipetadora_Homing();
+        for (const Verificacao* v : escolhidas) {
+            printf("\n== %s: %s ==\n", v->nome, v->descricao);
+            repousar();
+            Tempo inicio = sim::agora();
+            v->rodar();
+            printf("  (%.3f s virtuais)\n", seg(sim::agora() - inicio));
+        }
+        sim::terminar(falhas ? 1 : 0);
+    });
+    int codigo = sim::executar(hours(24));
+    printf("\n== %d medidas, %d falhas: %s (codigo %d) ==\n", medidas, falhas, sim::motivo(), codigo);
+    return codigo;
+}